@@ -19,17 +19,27 @@
 #include <WiFi.h>
 #include <esp_now.h>
 #include <esp_wifi.h>
+#include <esp_pm.h>
 #include "Node.h"
 #include "Device.h"
 #include "ThisNode.h"
 
 //--- Declarations ----------------------------------------
 
-void ESPNOW_Receiver (const esp_now_recv_info_t *info, const uint8_t *espnowString, int stringLength);
-// void onESPNOWSent    (const uint8_t *mac_addr, esp_now_send_status_t status);  // Not used in SMAC
+void ESPNOW_Receiver   (const esp_now_recv_info_t *info, const uint8_t *espnowString, int stringLength);
+void ESPNOW_SendFailed (const uint8_t *mac, const uint8_t *data, int length, bool final);
 
 extern bool  WaitingForRelayer;
 
+char  ReceiverNodeID[ID_SIZE+1] = "--";  // This Node's ID for ESPNOW_Receiver()
+bool  ReceiverGroups[MAX_GROUPS] = {};   // Groups this Node belongs to, for ESPNOW_Receiver()
+Node  *ReceiverNode = NULL;              // This Node, for emergency stops in ESPNOW_Receiver()
+int   RelayerFailures = 0;               // Messages to the Relayer lost since the last delivery
+volatile int  BeaconChannel = 0;         // Channel from a WFCH beacon heard while looking for the Relayer
+volatile int8_t  RelayerRSSI = 0;        // Signal strength of the last frame from the Relayer, 0 = taken by Run()
+volatile unsigned long  ReceiveTime = 0; // Time of the last Command for this Node (a sleepy Node listens on)
+const uint8_t  BroadcastMAC[MAC_SIZE] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };  // ESP-NOW broadcast address
+
 //--- Constructor -----------------------------------------
 
 Node::Node (const char *inName, int inNodeID)
@@ -50,6 +60,8 @@ Node::Node (const char *inName, int inNodeID)
     if (name[i] == ',') name[i] = '.';
 
   sprintf (nodeID, "%02d", inNodeID);
+  strcpy  (ReceiverNodeID, nodeID);
+  ReceiverNode = this;
 
   strcpy (version, "3.2");  // no more than 9 chars
 
@@ -70,17 +82,16 @@ Node::Node (const char *inName, int inNodeID)
   delay (100);
 
   Serial.print ("WiFi Channel is "); Serial.println (WiFi.channel());
+  channel = WiFi.channel ();
 
   // Load this Node's MAC address (ESP-NOW v2)
   WiFi.macAddress().toCharArray (macAddressString, sizeof(macAddressString));
 
 
 
-  // // Set ESP-NOW rate to 5-GHz for faster comms ???
-  // esp_now_rate_config_t  rateConfig = { ... };
-  // esp_now_set_peer_rate_config (macAddress, &rateConfig);
-
-
+  // Allow the Long Range rates; the rate of each peer is set when it is added
+  if (!rates.Begin ())
+    Serial.println ("ERROR: Unable to enable the WiFi Long Range protocol");
 
   // Init ESP-NOW protocol
   ESPNOW_Result = esp_now_init ();
@@ -106,6 +117,17 @@ Node::Node (const char *inName, int inNodeID)
     Serial.println (ESPNOW_Result);
     return;
   }
+  rates.Apply (RelayerMAC);
+
+  // Broadcast peer, used by SendData and SendCommand with <broadcast> set
+  memcpy (peerInfo.peer_addr, BroadcastMAC, MAC_SIZE);
+  ESPNOW_Result = esp_now_add_peer (&peerInfo);
+  if (ESPNOW_Result != ESP_OK)
+  {
+    Serial.print   ("ERROR: Unable to add broadcast peer: ");
+    Serial.println (ESPNOW_Result);
+    return;
+  }
 
   // Register receive event
   ESPNOW_Result = esp_now_register_recv_cb (ESPNOW_Receiver);
@@ -114,6 +136,12 @@ Node::Node (const char *inName, int inNodeID)
     Serial.print   ("ERROR: Unable to register ESP-NOW Command handler: ");
     Serial.println (ESPNOW_Result);
   }
+
+  // Register send event for delivery tracking
+  if (!outbox.Begin ())
+    Serial.println ("ERROR: Unable to register ESP-NOW send handler");
+  outbox.SetFailedHandler (ESPNOW_SendFailed);
+  outbox.SetRateControl   (&rates);
 }
 
 //--- AddDevice -------------------------------------------
@@ -146,7 +174,7 @@ IRAM_ATTR void Node::SendData (const char *sourceDeviceID, bool widgetData, bool
   // Build an ESPNOW Data string.  It has four fields separated with the '|' char:
   //
   //   ┌──────────── 1-char packet type ('W' for Widget Data, 'S' for System Data)
-  //   │ ┌────────── 2-char source nodeID (00-19)
+  //   │ ┌────────── 2-char source nodeID (00-99)
   //   │ │  ┌─────── 2-char source deviceID (00-99)
   //   │ │  │    ┌── variable length string of values (multiple values are comma delimited)
   //   │ │  │    │
@@ -154,6 +182,23 @@ IRAM_ATTR void Node::SendData (const char *sourceDeviceID, bool widgetData, bool
   //
   // ESPNOW strings must be NULL terminated.
   // A '|' and timestamp is appended to all Data Strings by the Relayer
+  //
+  // Values longer than one frame can hold are sent to the Relayer in fragments
+  // (when built with MAX_FRAGMENTS above 1).
+  // Broadcasts can't be acknowledged, so their values are cut to fit one frame.
+
+  if (strlen (SMACData.values) > MAX_FRAME_VALUES)
+  {
+#if MAX_FRAGMENTS > 1
+    if (!broadcast)
+    {
+      sendLong (sourceDeviceID, widgetData ? 'W' : 'S');
+      return;
+    }
+#endif
+
+    SMACData.values[MAX_FRAME_VALUES] = 0;
+  }
 
   memcpy (ESPNOW_String, "W|--|--|", 8);    // Default to Widget data
   if (!widgetData) ESPNOW_String[0] = 'S';  // System data
@@ -165,8 +210,8 @@ IRAM_ATTR void Node::SendData (const char *sourceDeviceID, bool widgetData, bool
 
   //=============================
   // Send Data String to Relayer
-  //=============================                                                                                       ┌─ include string terminator
-  ESPNOW_Result = esp_now_send (broadcast ? NULL : RelayerMAC, (const uint8_t *) ESPNOW_String, strlen(ESPNOW_String) + 1);
+  //=============================                                                                    ┌─ include string terminator
+  ESPNOW_Result = outbox.Send (broadcast ? NULL : RelayerMAC, ESPNOW_String, strlen(ESPNOW_String) + 1, widgetData ? SEND_BEST_EFFORT : SEND_RELIABLE);
   if (ESPNOW_Result != ESP_OK)
   {
     Serial.print   ("ERROR: Unable to send SMAC Data to Relayer: ");
@@ -184,6 +229,92 @@ IRAM_ATTR void Node::SendData (const char *sourceDeviceID, bool widgetData, bool
   }
 }
 
+#if MAX_FRAGMENTS > 1
+//--- sendLong --------------------------------------------
+
+void Node::sendLong (const char *sourceDeviceID, char type)
+{
+  // Keep the values until the Relayer has every fragment
+  // (if both slots are busy, the oldest long Data String is given up)
+  LongMessage *message = &longMessages[0];
+  for (int i=0; i<LONG_MESSAGE_SLOTS; i++)
+  {
+    if (!longMessages[i].active)
+    {
+      message = &longMessages[i];
+      break;
+    }
+
+    if ((long)(longMessages[i].sendTime - message->sendTime) < 0)
+      message = &longMessages[i];
+  }
+
+  if (message->active)
+  {
+    Serial.print   ("ERROR: Long Data String not delivered, message ");
+    Serial.println (message->messageID);
+  }
+
+  message->active    = true;
+  message->type      = type;
+  message->messageID = nextMessageID++;
+  message->length    = strlen (SMACData.values);
+  message->count     = (message->length + FRAGMENT_CHUNK - 1) / FRAGMENT_CHUNK;
+  message->acked     = 0;
+  message->numSends  = 0;
+  strcpy (message->deviceID, sourceDeviceID);
+  strcpy (message->values,   SMACData.values);
+
+  sendFragments (message);
+
+  // Save last send packet time (time of silence)
+  lastPacketTime = millis ();
+}
+
+//--- sendFragments ---------------------------------------
+
+void Node::sendFragments (LongMessage *message)
+{
+  // Send every fragment the Relayer doesn't have yet:
+  //
+  //   F|nn|dd|t,mid,index,count|chunk
+  //
+  // Fragments are sent best-effort; the Relayer's FACK tells which ones to send again.
+  for (int i=0; i<message->count; i++)
+  {
+    if (message->acked & (1 << i))
+      continue;
+
+    int chunkLength = message->length - i*FRAGMENT_CHUNK;
+    if (chunkLength > FRAGMENT_CHUNK)
+      chunkLength = FRAGMENT_CHUNK;
+
+    int headerLength = sprintf (ESPNOW_String, "F|%s|%s|%c,%u,%d,%u|", nodeID, message->deviceID, message->type,
+                                (unsigned int) message->messageID, i, (unsigned int) message->count);
+    memcpy (ESPNOW_String + headerLength, message->values + i*FRAGMENT_CHUNK, chunkLength);
+    ESPNOW_String[headerLength + chunkLength] = 0;
+
+    ESPNOW_Result = outbox.Send (RelayerMAC, ESPNOW_String, headerLength + chunkLength + 1, SEND_BEST_EFFORT);
+    if (ESPNOW_Result != ESP_OK)
+    {
+      Serial.print   ("ERROR: Unable to send fragment to Relayer: ");
+      Serial.println (ESPNOW_Result);
+    }
+  }
+
+  ++message->numSends;
+  message->sendTime = millis ();
+
+  if (Debugging)
+  {
+    Serial.print   ("Node --> Relayer : long Data String in ");
+    Serial.print   (message->count);
+    Serial.print   (" fragments, message ");
+    Serial.println (message->messageID);
+  }
+}
+#endif
+
 //--- SendCommand -----------------------------------------
 
 IRAM_ATTR void Node::SendCommand (const char *targetNodeID, const char *targetDeviceID, const char *command, const char *params, bool broadcast)
@@ -191,7 +322,7 @@ IRAM_ATTR void Node::SendCommand (const char *targetNodeID, const char *targetDe
   // Build an ESPNOW Command string.  It has four or five fields separated with the '|' char:
   //
   //   ┌───────────────── 1-char packet type ('C' for Command)
-  //   │ ┌─────────────── 2-char target nodeID (00-19)
+  //   │ ┌─────────────── 2-char target nodeID (00-99)
   //   │ │  ┌──────────── 2-char target deviceID (00-99)
   //   │ │  │   ┌──────── 4-char command (usually capital letters)
   //   │ │  │   │     ┌── optional variable length string of parameters (multiple params are comma delimited)
@@ -215,14 +346,41 @@ IRAM_ATTR void Node::SendCommand (const char *targetNodeID, const char *targetDe
     strcat (ESPNOW_String, params);
   }
 
-  //================================
-  // Send Command String to Relayer
-  //================================
-  ESPNOW_Result = esp_now_send (broadcast ? NULL : RelayerMAC, (const uint8_t *) ESPNOW_String, strlen(ESPNOW_String) + 1);
-  if (ESPNOW_Result != ESP_OK)
+  // Commands for another Node go directly to it if its MAC address is known
+  int  peerIndex = -1;
+  bool direct    = false;
+
+  if (!broadcast && isdigit (targetNodeID[0]) && isdigit (targetNodeID[1]) && strncmp (targetNodeID, nodeID, ID_SIZE) != 0)
   {
-    Serial.print   ("ERROR: Unable to send SMAC Command to Relayer: ");
-    Serial.println (ESPNOW_Result);
+    peerIndex = 10*(targetNodeID[0]-'0') + (targetNodeID[1]-'0');
+    if (peerIndex >= MAX_NODES)
+      peerIndex = -1;
+    else if (peerKnown[peerIndex])
+      direct = (outbox.Send (peerMACs[peerIndex], ESPNOW_String, strlen(ESPNOW_String) + 1, SEND_RELIABLE) == ESP_OK);
+  }
+
+  if (direct)
+  {
+    // Send a copy to the Relayer for the Diagnostic Monitor only
+    ESPNOW_String[0] = 'c';
+    outbox.Send (RelayerMAC, ESPNOW_String, strlen(ESPNOW_String) + 1, SEND_BEST_EFFORT);
+    ESPNOW_String[0] = 'C';
+  }
+  else
+  {
+    //================================
+    // Send Command String to Relayer
+    //================================
+    ESPNOW_Result = outbox.Send (broadcast ? NULL : RelayerMAC, ESPNOW_String, strlen(ESPNOW_String) + 1, SEND_RELIABLE);
+    if (ESPNOW_Result != ESP_OK)
+    {
+      Serial.print   ("ERROR: Unable to send SMAC Command to Relayer: ");
+      Serial.println (ESPNOW_Result);
+    }
+
+    // Ask for the target's MAC address so the next command can go direct
+    if (peerIndex >= 0 && !peerKnown[peerIndex])
+      requestPeer (peerIndex);
   }
 
   // Save last send packet time (time of silence)
@@ -231,7 +389,7 @@ IRAM_ATTR void Node::SendCommand (const char *targetNodeID, const char *targetDe
   if (Debugging)
   {
     // Show the outgoing Command String
-    Serial.print   ("Node --> Relayer : ");
+    Serial.print   (direct ? "Node --> Node    : " : "Node --> Relayer : ");
     Serial.println (ESPNOW_String);
   }
 }
@@ -248,11 +406,127 @@ IRAM_ATTR void Node::SendCommand (const char *targetNodeID, const char *targetDe
 
 void Node::Run ()
 {
+  //===================================
+  //  Run and report an emergency stop
+  //===================================
+  for (int i=0; i<numDevices; i++)
+    devices[i]->RunEStop ();
+
+  if (estopPending)
+  {
+    // S|nn|dd|ESTOP=seq, ahead of everything else
+    estopPending = false;
+    sprintf (ESPNOW_String, "S|%s|%s|ESTOP=%u", nodeID, estopDeviceID, (unsigned int) estopSeq);
+    outbox.Send (RelayerMAC, ESPNOW_String, strlen(ESPNOW_String) + 1, SEND_PRIORITY);
+  }
+
+  //===================================
+  //  Retry and send waiting messages
+  //===================================
+  outbox.Service ();
+
+#if MAX_FRAGMENTS > 1
+  // Send the missing fragments of long Data Strings again if the Relayer's FACK is late
+  for (int i=0; i<LONG_MESSAGE_SLOTS; i++)
+  {
+    LongMessage *message = &longMessages[i];
+    if (message->active && millis() - message->sendTime >= FRAGMENT_RETRY_TIME)
+    {
+      if (message->numSends > FRAGMENT_MAX_RETRIES)
+      {
+        message->active = false;
+        Serial.print   ("ERROR: Long Data String not delivered, message ");
+        Serial.println (message->messageID);
+      }
+      else
+        sendFragments (message);
+    }
+  }
+#endif
+
+  // The Relayer's signal strength caps the rate to it
+  if (RelayerRSSI != 0)
+  {
+    rates.RecordRSSI (RelayerMAC, RelayerRSSI);
+    RelayerRSSI = 0;
+  }
+
+  //===================================
+  //  Scheduled WiFi channel switch
+  //===================================
+  if (pendingChannel != 0 && (long)(millis() - switchTime) >= 0)
+  {
+    setChannel (pendingChannel);
+    pendingChannel = 0;
+
+    // Report from the new channel, so the Relayer knows this Node followed
+    sprintf (SMACData.values, "CHANNEL=%d", channel);
+    SendData ("--", false);
+  }
+
+  //===================================
+  //  Look for a Relayer that is gone
+  //===================================
+  if (outbox.GetDelivered () != lastDelivered)
+  {
+    lastDelivered   = outbox.GetDelivered ();
+    RelayerFailures = 0;
+  }
+
+  if (RelayerFailures >= RELAYER_LOST_FAILURES && !WaitingForRelayer)
+  {
+    Serial.println ("Relayer is not answering; looking for it ...");
+    RelayerFailures   = 0;
+    WaitingForRelayer = true;
+  }
+
+  if (WaitingForRelayer)
+    FindRelayer ();
+  else if (searchStep >= 0)
+  {
+    // Found it (PONG)
+    searchStep = -1;
+    STATUS_LED_GOOD;
+
+    sprintf (SMACData.values, "CHANNEL=%d", channel);
+    SendData ("--", false);
+
+    // The Relayer forgets that a Node is sleepy when it PINGs
+    sleepyAnnounce = (listenTime > 0);
+  }
+
+  if (sleepyAnnounce && !WaitingForRelayer)
+  {
+    sleepyAnnounce = false;
+    sprintf (SMACData.values, "SLEEPY=%lu", listenTime);
+    SendData ("--", false);
+  }
+
+  //===================================
+  //  Send the next Device Info (GDEI)
+  //===================================
+  // One DEINFO per Run, and only when the send queue has caught up
+  if (deviceInfoIndex >= 0 && outbox.GetWaiting () == 0)
+  {
+    if (deviceInfoIndex < numDevices)
+    {
+      Device *device = devices[deviceInfoIndex++];
+      sprintf (SMACData.values, "DEINFO=%s,%s,%c,%c,%lu", device->GetName(), device->GetVersion(), device->IsIPEnabled() ? 'Y':'N', device->IsPPEnabled() ? 'Y':'N', device->GetRate());
+      SendData (device->GetID(), false);
+    }
+
+    if (deviceInfoIndex >= numDevices)
+      deviceInfoIndex = -1;
+  }
+
   //===================================
   //  Run all Devices
   //===================================
   for (deviceIndex=0; deviceIndex<numDevices; deviceIndex++)
   {
+    // An emergency stop that came in since the top of Run() goes first
+    devices[deviceIndex]->RunEStop ();
+
     //--- Immediate Processing ---
     if (devices[deviceIndex]->IsIPEnabled ())
     {
@@ -302,6 +576,14 @@ void Node::Run ()
       int cLength = strlen (commandString);
       if (cLength < MIN_COMMAND_LENGTH)
         Serial.println ("ERROR: Invalid command");
+      else if (commandString[2] == 'G')
+      {
+        //--- Execute Group Command: C|Gg|--|cccc[|params] ---
+        if (cLength > MIN_COMMAND_LENGTH)
+          commandString[MIN_COMMAND_LENGTH] = 0;  // Terminate Command string
+
+        runGroupCommand (commandString[3] - '0', commandString + CommandOffset, (cLength > MIN_COMMAND_LENGTH) ? commandString + ParamsOffset : NULL);
+      }
       else
       {
         //--- Execute Node Command ---
@@ -327,7 +609,11 @@ void Node::Run ()
           deviceIndex = 10*((int)(commandString[5])-48) + ((int)(commandString[6])-48);
 
           // Check deviceIndex range
-          if (deviceIndex >= numDevices)
+          if (deviceIndex < 0)
+            ;  // Node command ("--") that was not handled
+          else if (deviceIndex >= numDevices && commandString[2] == '-')
+            pStatus = NODATA;  // Broadcast for a Device this Node doesn't have
+          else if (deviceIndex >= numDevices)
           {
             if (Debugging)
             {
@@ -372,12 +658,247 @@ void Node::Run ()
   }
 
   // Check if this Node has been silent for some time.
-  // If so, send a PONG to let the Interface know it is still alive.
+  // If so, send a tiny heartbeat to let the Relayer know it is still alive
+  // (anything else this Node sends counts as a heartbeat too).
   if (millis() - lastPacketTime > MAX_SILENT_DURATION)
   {
-    strcpy (SMACData.values, "PONG");
+    strcpy (SMACData.values, HEARTBEAT_VALUE);
     SendData ("--", false);
   }
+
+  // Sleep until there is something to do
+  if (listenTime > 0 && !WaitingForRelayer)
+    sleep ();
+}
+
+//--- sleep -----------------------------------------------
+
+void Node::sleep ()
+{
+  // Listen for a while after each frame sent or Command received,
+  // and stay awake while anything is left to send or do
+  unsigned long now = millis ();
+
+  if (now - lastPacketTime < listenTime || now - ReceiveTime < listenTime)
+  {
+    doze (false);
+    return;
+  }
+
+  if (outbox.GetWaiting () > 0 || outbox.GetInFlight () > 0 || CommandBuffer->GetNumElements () > 0 ||
+      deviceInfoIndex >= 0 || estopPending || sleepyAnnounce || pendingChannel != 0)
+    return;
+
+#if MAX_FRAGMENTS > 1
+  for (int i=0; i<LONG_MESSAGE_SLOTS; i++)
+    if (longMessages[i].active)
+      return;
+#endif
+
+  // Wake up for the next periodic process or heartbeat
+  unsigned long wakeTime = lastPacketTime + MAX_SILENT_DURATION;
+  for (int i=0; i<numDevices; i++)
+  {
+    if (devices[i]->IsIPEnabled ())
+      return;
+
+    if (devices[i]->IsPPEnabled () && (long)(devices[i]->GetNextTime () - wakeTime) < 0)
+      wakeTime = devices[i]->GetNextTime ();
+  }
+
+  long duration = (long)(wakeTime - now);
+  if (duration < SLEEPY_MIN_SLEEP)
+    return;
+
+  // Let the radio doze between its wake windows and block this task;
+  // with nothing else to run, power management light-sleeps the CPU.
+  // WiFi stays started, so the channel and ESP-NOW peers are kept.
+  // Wake up early for a Command or emergency stop heard in a wake window.
+  doze (true);
+  Serial.flush ();
+
+  while (duration > 0 && CommandBuffer->GetNumElements () == 0 && !estopPending)
+  {
+    delay ((duration < SLEEPY_STEP) ? duration : SLEEPY_STEP);
+    duration -= SLEEPY_STEP;
+  }
+}
+
+//--- doze ------------------------------------------------
+
+void Node::doze (bool on)
+{
+  // Switch the radio between listening all the time and the connectionless
+  // power-save schedule set up by SetSleepy (wake windows only)
+  if (on == dozing)
+    return;
+
+  esp_wifi_set_ps (on ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+  dozing = on;
+}
+
+//--- requestPeer -----------------------------------------
+
+void Node::requestPeer (int peerIndex)
+{
+  // Ask the Relayer for the MAC address of another Node: C|mm|--|GPDR
+  // Don't ask again too soon, the Node may not have registered yet
+  if (peerRequestTime[peerIndex] != 0 && millis() - peerRequestTime[peerIndex] < PEER_REQUEST_INTERVAL)
+    return;
+
+  peerRequestTime[peerIndex] = millis ();
+  if (peerRequestTime[peerIndex] == 0)
+    peerRequestTime[peerIndex] = 1;  // 0 means never asked
+
+  char  request[MIN_COMMAND_LENGTH+1];
+  sprintf (request, "C|%02d|--|GPDR", peerIndex);
+  outbox.Send (RelayerMAC, request, MIN_COMMAND_LENGTH + 1, SEND_BEST_EFFORT);
+}
+
+//--- setPeer ---------------------------------------------
+
+void Node::setPeer (int peerIndex, const uint8_t *mac)
+{
+  // Forget any old MAC address for this Node
+  if (peerKnown[peerIndex])
+  {
+    peerKnown[peerIndex] = false;
+    if (memcmp (peerMACs[peerIndex], RelayerMAC, MAC_SIZE) != 0)
+      esp_now_del_peer (peerMACs[peerIndex]);
+  }
+
+  // NULL = the Node is not registered with the Relayer (yet)
+  if (mac == NULL)
+    return;
+
+  memcpy (peerMACs[peerIndex], mac, MAC_SIZE);
+
+  if (!esp_now_is_peer_exist (mac))
+  {
+    esp_now_peer_info_t  peerInfo = {};
+    memcpy (peerInfo.peer_addr, mac, MAC_SIZE);
+    peerInfo.channel = 0;  // 0 = Current channel
+    peerInfo.encrypt = false;
+
+    // ESP-NOW has a limited number of peers; keep using the Relayer if full
+    if (esp_now_add_peer (&peerInfo) != ESP_OK)
+      return;
+  }
+  rates.Apply (mac);
+
+  peerKnown[peerIndex] = true;
+}
+
+//--- FindRelayer -----------------------------------------
+
+void Node::FindRelayer ()
+{
+  // PING the Relayer on this channel, then wait on the rendezvous channel for the
+  // Relayer's WFCH beacon, then PING on every channel in turn.  ESPNOW_Receiver()
+  // clears WaitingForRelayer when the PONG comes back.
+  unsigned long now = millis ();
+
+  if (searchStep < 0)
+  {
+    STATUS_LED_BAD;
+    searchStep     = 0;
+    searchStepTime = now;
+    pendingChannel = 0;
+  }
+  else if (BeaconChannel > 0)
+  {
+    // The Relayer told where it went, start again there
+    setChannel (BeaconChannel);
+    BeaconChannel  = 0;
+    searchStep     = 0;
+    searchStepTime = now;
+  }
+  else if (now - searchStepTime >= ((searchStep == 1) ? RENDEZVOUS_WAIT : CHANNEL_SEARCH_DWELL))
+  {
+    ++searchStep;
+    searchStepTime = now;
+    setChannel ((searchStep == 1) ? RENDEZVOUS_CHANNEL : 1 + (searchStep - 2) % MAX_CHANNEL);
+  }
+
+  if (now - lastSearchPing >= CHANNEL_SEARCH_PING)
+  {
+    lastSearchPing = now;
+
+    // Best effort, the next PING is coming anyway
+    sprintf (ESPNOW_String, "S|%s|--|PING", nodeID);
+    outbox.Send (RelayerMAC, ESPNOW_String, strlen(ESPNOW_String) + 1, SEND_BEST_EFFORT);
+  }
+}
+
+//--- setChannel ------------------------------------------
+
+void Node::setChannel (int newChannel)
+{
+  if (esp_wifi_set_channel ((uint8_t) newChannel, WIFI_SECOND_CHAN_NONE) == ESP_OK)
+    channel = (uint8_t) newChannel;
+}
+
+//--- EStop -----------------------------------------------
+
+void Node::EStop (const char *estopString)
+{
+  // E|nn|dd|cccc|seq  (nn may be "--" or a group Gg)
+  // Called from the WiFi task, so only latch the stop; Run() stops the Devices and reports it
+  uint16_t seq = (uint16_t) atoi (estopString + MIN_COMMAND_LENGTH + 1);
+
+  if (seq == estopSeq && millis() - estopTime < ESTOP_REPEAT_TIME)
+    return;  // Another copy of the same emergency stop
+
+  estopSeq  = seq;
+  estopTime = millis ();
+
+  int groupIndex  = (estopString[2] == 'G') ? estopString[3] - '0' : -1;
+  int targetIndex = (isdigit (estopString[5]) && isdigit (estopString[6])) ? 10*(estopString[5]-'0') + (estopString[6]-'0') : -1;
+
+  for (int i=0; i<numDevices; i++)
+  {
+    if (groupIndex >= 0 ? (groupIndex < MAX_GROUPS && groupDevices[groupIndex][i]) : (targetIndex < 0 || targetIndex == i))
+      devices[i]->LatchEStop ();
+  }
+
+  memcpy (estopDeviceID, estopString + 5, ID_SIZE);
+  estopPending = true;
+}
+
+//--- runGroupCommand -------------------------------------
+
+void Node::runGroupCommand (int groupIndex, char *command, char *params)
+{
+  // Execute a group command on this Node (if a member) and each member Device.
+  // Every member gets its own copy of the params, in case a command changes them.
+  char  paramsCopy[MAX_ESPNOW_LENGTH+1];
+
+  if (groupIndex < 0 || groupIndex >= MAX_GROUPS)
+    return;
+
+  for (deviceIndex=-1; deviceIndex<numDevices; deviceIndex++)
+  {
+    if (deviceIndex < 0 ? !groupNode[groupIndex] : !groupDevices[groupIndex][deviceIndex])
+      continue;
+
+    if (params != NULL)
+      strcpy (paramsCopy, params);
+
+    if (deviceIndex < 0)
+      pStatus = ExecuteCommand (command, (params == NULL) ? NULL : paramsCopy);
+    else
+      pStatus = devices[deviceIndex]->ExecuteCommand (command, (params == NULL) ? NULL : paramsCopy);
+
+    if (pStatus == NOT_HANDLED)
+    {
+      sprintf (SMACData.values, "ERROR: Unknown command: %s", command);
+      pStatus = SYSTEM_DATA;
+    }
+
+    // Any data to send?
+    if (pStatus != NODATA)
+      SendData ((deviceIndex < 0) ? "--" : devices[deviceIndex]->GetID(), (pStatus == WIDGET_DATA));
+  }
 }
 
 //--- GetVersion ------------------------------------------
@@ -387,6 +908,65 @@ char * Node::GetVersion ()
   return version;
 }
 
+//--- SetSleepy -------------------------------------------
+
+void Node::SetSleepy (unsigned long newListenTime)
+{
+  // Sleep between transmissions, listening for <newListenTime> millis after each one.
+  // Can be called any time; the Relayer is told right away (SLEEPY=ms).
+  //
+  // While a sleepy Node dozes, the radio only listens for SLEEPY_WAKE_WINDOW millis every
+  // SLEEPY_WAKE_INTERVAL (connectionless power save) and the CPU light-sleeps whenever it is idle.
+  // Automatic light sleep needs a core built with CONFIG_PM_ENABLE and CONFIG_FREERTOS_USE_TICKLESS_IDLE;
+  // without it, only the radio saves power.
+  esp_pm_config_t pmConfig;
+  bool            wasSleepy = (listenTime > 0);
+
+  if (newListenTime == listenTime)
+    return;
+
+  listenTime     = newListenTime;
+  sleepyAnnounce = true;
+
+  // Only the listen time changed
+  if ((listenTime > 0) == wasSleepy)
+    return;
+
+  pmConfig.max_freq_mhz       = getCpuFrequencyMhz ();
+  pmConfig.min_freq_mhz       = (listenTime > 0) ? getXtalFrequencyMhz () : pmConfig.max_freq_mhz;
+  pmConfig.light_sleep_enable = (listenTime > 0);
+
+  ESPNOW_Result = esp_pm_configure (&pmConfig);
+  if (ESPNOW_Result != ESP_OK)
+  {
+    Serial.print   ("ERROR: Unable to set up automatic light sleep: ");
+    Serial.println (ESPNOW_Result);
+  }
+
+  // The soft AP keeps the radio on, so a sleepy Node is a Wi-Fi Station only
+  // (the ESP-NOW peers and this Node's MAC address are on the Station interface)
+  if (!WiFi.mode ((listenTime > 0) ? WIFI_STA : WIFI_AP_STA))
+    Serial.println ("ERROR: Unable to set WiFi mode");
+  setChannel (channel);
+
+  esp_now_set_wake_window (SLEEPY_WAKE_WINDOW);
+  esp_wifi_connectionless_module_set_wake_interval (SLEEPY_WAKE_INTERVAL);
+
+  // Listen all the time until there's nothing to do
+  doze (false);
+}
+
+//--- GetThrottle -----------------------------------------
+
+float Node::GetThrottle ()
+{
+  // A throttle the Relayer stopped repeating is over
+  if (throttle > 1.0f && millis() - throttleTime >= THROTTLE_HOLD_TIME)
+    throttle = 1.0f;
+
+  return throttle;
+}
+
 //=========================================================
 //  ExecuteCommand:
 //
@@ -430,14 +1010,11 @@ ProcessStatus Node::ExecuteCommand (char *command, char *params)
   //--- Get Device Info (GDEI) ----------------------------
   else if (strncmp (command, "GDEI", COMMAND_SIZE) == 0)
   {
-    // For each Device, send a Data Packet with values = name,version,ipEnabled(Y/N),ppEnabled(Y/N),periodic data rate
-    for (int i=0; i<numDevices; i++)
-    {
-      sprintf (SMACData.values, "DEINFO=%s,%s,%c,%c,%lu", devices[i]->GetName(), devices[i]->GetVersion(), devices[i]->IsIPEnabled() ? 'Y':'N', devices[i]->IsPPEnabled() ? 'Y':'N', devices[i]->GetRate());
-      SendData (devices[i]->GetID(), false);
-    }
+    // For each Device, a Data Packet with values = name,version,ipEnabled(Y/N),ppEnabled(Y/N),periodic data rate
+    // is sent by Run(), one per call, so a Node with many Devices doesn't flood the Relayer
+    deviceInfoIndex = 0;
 
-    // All Device data has been sent, no need to send anything else
+    // Nothing else to send now
     pStatus = NODATA;
   }
 
@@ -453,27 +1030,89 @@ ProcessStatus Node::ExecuteCommand (char *command, char *params)
   //--- Change WiFi Channel (WFCH) ------------------------
   else if (strncmp (command, "WFCH", COMMAND_SIZE) == 0)
   {
-    if (strlen (params) > 0)
+    // ch     : change now
+    // ch,ms  : change in ms milliseconds, together with every other peer.
+    //          The Relayer repeats the announcement, so later copies only update the time.
+    if (params != NULL && strlen (params) > 0)
     {
       // Get new channel
-      uint8_t newChannel = (uint8_t) atoi (params);
+      int   newChannel = atoi (params);
+      char *delay      = strchr (params, ',');
 
-      if (newChannel >= 0 && newChannel <= 14)
+      if (newChannel < 1 || newChannel > MAX_CHANNEL)
       {
-        // Acknowledge change
-        sprintf (SMACData.values, "New WiFi Channel rquested; Changing to channel %d", newChannel);
-
-        // Change ESP-NOW WiFi Channel to new channel
-        esp_wifi_set_channel (newChannel, WIFI_SECOND_CHAN_NONE);
-
+        strcpy (SMACData.values, "ERROR: Invalid WiFi Channel");
         pStatus = SYSTEM_DATA;
       }
+      else if (delay != NULL && atol (delay + 1) > 0)
+      {
+        // Switch in Run()
+        pendingChannel = (uint8_t) newChannel;
+        switchTime     = millis () + atol (delay + 1);
+        pStatus        = NODATA;
+      }
+      else if (newChannel == channel)
+        pStatus = NODATA;  // Already there (e.g. a rendezvous beacon)
       else
       {
-        strcpy (SMACData.values, "ERROR: Invalid WiFi Channel");
+        // Change ESP-NOW WiFi Channel to new channel
+        pendingChannel = 0;
+        setChannel (newChannel);
+
+        // Acknowledge change
+        sprintf (SMACData.values, "CHANNEL=%d", channel);
         pStatus = SYSTEM_DATA;
       }
     }
+    else
+    {
+      strcpy (SMACData.values, "ERROR: Missing WiFi Channel");
+      pStatus = SYSTEM_DATA;
+    }
+  }
+
+#if MAX_FRAGMENTS > 1
+  //--- Fragment Acknowledge (FACK) ----------------------
+  else if (strncmp (command, "FACK", COMMAND_SIZE) == 0)
+  {
+    // From the Relayer: mid,bitmap (hex, bit i = fragment i received)
+    // Once every fragment is in, the long Data String is done; otherwise send the missing ones now
+    char *bitmap = (params != NULL) ? strchr (params, ',') : NULL;
+    if (bitmap != NULL)
+    {
+      int messageID = atoi (params);
+      for (int i=0; i<LONG_MESSAGE_SLOTS; i++)
+      {
+        LongMessage *message = &longMessages[i];
+        if (message->active && message->messageID == messageID)
+        {
+          message->acked |= (uint16_t) strtoul (bitmap + 1, NULL, 16);
+
+          if (message->acked == (uint16_t)((1 << message->count) - 1))
+            message->active = false;
+          else if (message->numSends <= FRAGMENT_MAX_RETRIES)
+            sendFragments (message);  // Run() gives up on it otherwise
+          break;
+        }
+      }
+    }
+
+    pStatus = NODATA;
+  }
+#endif
+
+  //--- Congestion Throttle (THRO) ----------------------
+  else if (strncmp (command, "THRO", COMMAND_SIZE) == 0)
+  {
+    // From the Relayer: factor (1.00 = full rate) for the periodic processes of all Devices
+    float factor = (params != NULL) ? atof (params) : 1.0f;
+    if (factor < 1.0f)                factor = 1.0f;
+    if (factor > THROTTLE_MAX_FACTOR) factor = THROTTLE_MAX_FACTOR;
+
+    throttle     = factor;
+    throttleTime = millis ();
+
+    pStatus = NODATA;
   }
 
   //--- Blink (BLIN) --------------------------------------
@@ -499,6 +1138,66 @@ ProcessStatus Node::ExecuteCommand (char *command, char *params)
     pStatus = SYSTEM_DATA;
   }
 
+  //--- Peer Directory Entry (PEER) ----------------------
+  else if (strncmp (command, "PEER", COMMAND_SIZE) == 0)
+  {
+    // From the Relayer: mm,xx:xx:xx:xx:xx:xx  or just mm if Node mm is unknown
+    // Only entries this Node asked for (or already cached) are used
+    if (params != NULL)
+    {
+      int peerIndex = atoi (params);
+      if (peerIndex >= 0 && peerIndex < MAX_NODES && (peerKnown[peerIndex] || peerRequestTime[peerIndex] != 0))
+      {
+        unsigned int  mac[MAC_SIZE];
+        uint8_t       peerMAC[MAC_SIZE];
+
+        if (sscanf (params, "%*d,%x:%x:%x:%x:%x:%x", &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) == MAC_SIZE)
+        {
+          for (int i=0; i<MAC_SIZE; i++)
+            peerMAC[i] = (uint8_t) mac[i];
+
+          setPeer (peerIndex, peerMAC);
+        }
+        else
+          setPeer (peerIndex, NULL);
+      }
+    }
+
+    pStatus = NODATA;
+  }
+
+  //--- Group Membership (JGRP) --------------------------
+  else if (strncmp (command, "JGRP", COMMAND_SIZE) == 0)
+  {
+    // From the Relayer: g,dd,dd,...  or just g to leave the group
+    if (params != NULL)
+    {
+      int groupIndex = atoi (params);
+      if (groupIndex >= 0 && groupIndex < MAX_GROUPS)
+      {
+        groupNode[groupIndex] = false;
+        memset (groupDevices[groupIndex], 0, sizeof(groupDevices[groupIndex]));
+        ReceiverGroups[groupIndex] = false;
+
+        for (char *member = strchr (params, ','); member != NULL; member = strchr (member + 1, ','))
+        {
+          if (member[1] == '-')
+            groupNode[groupIndex] = true;
+          else
+          {
+            int memberIndex = atoi (member + 1);
+            if (memberIndex >= 0 && memberIndex < MAX_DEVICES)
+              groupDevices[groupIndex][memberIndex] = true;
+          }
+
+          ReceiverGroups[groupIndex] = true;
+        }
+      }
+    }
+
+    pStatus = NODATA;
+  }
+
   //--- Reset (RSET) --------------------------------------
   else if (strncmp (command, "RSET", COMMAND_SIZE) == 0)
   {
@@ -521,6 +1220,22 @@ ProcessStatus Node::ExecuteCommand (char *command, char *params)
 // External "C" Functions
 //=========================================================
 
+//--- ESPNOW_SendFailed -----------------------------------
+
+void ESPNOW_SendFailed (const uint8_t *mac, const uint8_t *data, int length, bool final)
+{
+  // Called from Run() for every failed send; only report messages that are given up on
+  if (final)
+  {
+    // Too many of these and the Node looks for the Relayer on other channels (see Run)
+    if (memcmp (mac, RelayerMAC, MAC_SIZE) == 0)
+      ++RelayerFailures;
+
+    Serial.print   ("ERROR: ESP-NOW message lost: ");
+    Serial.println ((const char *) data);
+  }
+}
+
 //--- ESPNOW_Receiver -------------------------------------
 
 void ESPNOW_Receiver (const esp_now_recv_info_t *info, const uint8_t *espnowString, int stringLength)
@@ -532,13 +1247,45 @@ void ESPNOW_Receiver (const esp_now_recv_info_t *info, const uint8_t *espnowStri
     Serial.println ((char *) espnowString);
   }
 
+  if (memcmp (info->src_addr, RelayerMAC, MAC_SIZE) == 0)
+    RelayerRSSI = (int8_t) info->rx_ctrl->rssi;
+
   // Check if Relayer responded to initial PING
   if (strncmp ((char *) espnowString, "PONG", COMMAND_SIZE) == 0)
     WaitingForRelayer = false;
 
-  else if ((char)(espnowString[0]) == 'C')  // Data messages are ignored
+  else if ((char)(espnowString[0]) == 'C' || (char)(espnowString[0]) == 'E')  // Data messages are ignored
   {
+    // The Relayer broadcasts Commands when it has no free ESP-NOW peer for
+    // the target Node, so ignore Commands for other Nodes
+    if (stringLength > 3 && espnowString[2] == 'G')
+    {
+      // Group command, ignore unless this Node is a member
+      int groupIndex = espnowString[3] - '0';
+      if (groupIndex < 0 || groupIndex >= MAX_GROUPS || !ReceiverGroups[groupIndex])
+        return;
+    }
+    else if (stringLength > 3 && espnowString[2] != '-' && strncmp ((char *) espnowString + 2, ReceiverNodeID, ID_SIZE) != 0)
+      return;
+
+    // While looking for the Relayer, its WFCH beacon tells which channel it is on
+    if (WaitingForRelayer && stringLength > MIN_COMMAND_LENGTH + 1 && strncmp ((char *) espnowString + CommandOffset, "WFCH", COMMAND_SIZE) == 0)
+    {
+      int beaconChannel = atoi ((char *) espnowString + ParamsOffset);
+      if (beaconChannel >= 1 && beaconChannel <= MAX_CHANNEL)
+        BeaconChannel = beaconChannel;
+    }
+
+    // Emergency stops are executed right away
+    if ((char)(espnowString[0]) == 'E')
+    {
+      if (stringLength > MIN_COMMAND_LENGTH && ReceiverNode != NULL)
+        ReceiverNode->EStop ((const char *) espnowString);
+      return;
+    }
+
     // Add this command to the Command buffer
     CommandBuffer->PushString ((char *) espnowString);
+    ReceiveTime = millis ();
   }
 }
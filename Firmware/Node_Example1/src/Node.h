@@ -8,7 +8,7 @@
 //
 //            █ A Node is an ESP32 Development board (with Devices attached) and uses
 //              Espressif's ESP-NOW protocol to connect to a single Relayer module.
-//              Each Node in your SMAC system will have a unique ID (0-19) which is
+//              Each Node in your SMAC system will have a unique ID (0-99) which is
 //              given when constructed.
 //
 //            █ The ESP32 Dev board has an RGB LED that is used as a "Status" LED:
@@ -33,15 +33,84 @@
 //                GNOI = Get Node Info   : SMACData.values = NOINFO=name|version|macAddress|numDevices
 //                GDEI = Get Device Info : SMACData.values = DEINFO=name|version|ipEnabled|ppEnabled|rate
 //                PING = Check if still alive and connected; responds with "PONG"
-//                WFCH = Set New ESP-NOW WiFi Channel
+//                WFCH = Set New ESP-NOW WiFi Channel: ch (now) or ch,ms (in ms milliseconds, see below)
 //                BLIN = Quickly blink the Node's status LED to indicate communication or location
 //                GNVR = Get Node Firmware Version
 //                RSET = Reset this Node's processor using esp_restart()
+//                PEER = Peer directory entry from the Relayer (see below)
+//                JGRP = Group membership from the Relayer (see below)
+//                FACK = Fragments of a long Data String received by the Relayer (see below)
+//                THRO = Congestion throttle from the Relayer (see below)
+//
+//            █ Commands for other Nodes are sent directly to the target Node once its MAC address
+//              is known, instead of going through the Relayer.  The first command for a Node goes
+//              through the Relayer as usual and also asks the Relayer for the target's MAC address:
+//
+//                C|mm|--|GPDR  -->  C|nn|--|PEER|mm,xx:xx:xx:xx:xx:xx
+//
+//              The MAC address is then cached as an ESP-NOW peer.  After each direct send, a copy
+//              of the command (with a lower case 'c' type) is sent to the Relayer so it still shows
+//              in the Interface's Diagnostic Monitor.
+//
+//            █ A command for all Nodes (C|--|dd|cccc) or for a group (C|Gg|--|cccc) arrives as one
+//              broadcast frame.  The Relayer tells each member Node which of its Devices are in a group:
+//
+//                C|nn|--|JGRP|g,dd,dd,...   ("--" for the Node itself, just "g" to leave the group)
+//
+//              A group command is executed by every member Device of this Node and ignored by
+//              Nodes that are not members.  A command for all Nodes is ignored by Nodes that
+//              don't have Device dd.
+//
+//            █ An emergency stop (E|nn|dd|cccc|seq) skips the Command buffer: the ESP-NOW receive
+//              callback latches it for the target Device (all Devices for "--", member Devices for a
+//              group) and Run() calls their EStop() first thing, and again right before each
+//              Device's DoImmediate().  The Relayer sends several copies, so repeats
+//              of the same seq are ignored.  Run() then reports S|nn|dd|ESTOP=seq ahead of all
+//              other messages, which lets the Relayer measure the emergency stop latency.
+//
+//            █ The Relayer moves the whole SMAC network to another WiFi channel (see its SURV and
+//              WFCH commands) by announcing the switch several times: C|--|--|WFCH|ch,msLeft.
+//              Every Node switches when the time is up and reports S|nn|--|CHANNEL=ch from the new
+//              channel.  A Node that keeps losing messages to the Relayer (RELAYER_LOST_FAILURES) has
+//              probably missed a switch.  It goes red and looks for the Relayer with FindRelayer():
+//              PINGs on its own channel, then waits on RENDEZVOUS_CHANNEL for the Relayer's
+//              C|--|--|WFCH|ch,0 beacon, then PINGs on every channel in turn until a PONG comes back.
+//              A starting Node looks for the Relayer the same way.
+//
+//            █ The Relayer reports a Node that has gone silent with S|nn|--|NODEDOWN (see its SLIV command).
+//              A Node that has sent nothing for MAX_SILENT_DURATION sends a heartbeat, S|nn|--|HB,
+//              which the Relayer does not pass on to the Interface.
+//
+//            █ While the radio or serial link is congested, the Relayer broadcasts C|--|--|THRO|factor.
+//              Every Device then runs its periodic process <factor> times slower than its rate
+//              (up to THROTTLE_MAX_FACTOR).  The Relayer repeats the broadcast while it throttles and
+//              a Node goes back to full rate if it hears nothing for THROTTLE_HOLD_TIME.
+//
+//            █ A battery powered Node can sleep between transmissions with SetSleepy(listenTime).
+//              It tells the Relayer with S|nn|--|SLEEPY=listenTime and then, whenever it has nothing
+//              to do, lets the radio doze (ESP-NOW wake windows) and the CPU light-sleep until the next
+//              periodic process or heartbeat.
+//              After each frame it sends, it listens for <listenTime> millis; the Relayer holds the
+//              commands for the Node until then (see Mailbox.h of the Relayer).  Devices with
+//              Immediate Processing enabled keep the Node awake.  Broadcasts and emergency stops that
+//              come while it sleeps are missed unless they fall in one of its wake windows.
 //
 //            █ A child Node class can override ExecuteCommand() to handle custom commands.
 //              It should first call this base class's ExecuteCommand() to handle the built-in Node commands:
 //                Node::ExecuteCommand()
 //
+//            █ All ESP-NOW messages are sent through a SendQueue (see SendQueue.h).
+//              Widget Data is sent best-effort; Commands and System Data are retried until delivered.
+//              The PHY rate to each peer follows its delivery success and RSSI (see RateControl.h).
+//
+//            █ Values are limited to MAX_FRAME_VALUES chars unless the Node is built with MAX_FRAGMENTS
+//              above 1 (e.g. -D MAX_FRAGMENTS=10 in platformio.ini, no more than the Relayer's).
+//              Data Strings with more than MAX_FRAME_VALUES chars of values are then sent to the Relayer
+//              in fragments of FRAGMENT_CHUNK chars: F|nn|dd|t,mid,index,count|chunk
+//              (see Reassembler.h of the Relayer).  The Relayer answers with C|nn|--|FACK|mid,bitmap
+//              and only the missing fragments are sent again.  A long Data String is given up after
+//              FRAGMENT_MAX_RETRIES resends without a complete FACK.
+//
 //            █ Data can be returned from ExecuteCommand() by filling the 'values' field of the
 //              global <SMACData> structure and returning a ProcessStatus with data to send.
 //
@@ -64,11 +133,29 @@
 //--- Includes ---------------------------------------------
 
 #include "common.h"
+#include "SendQueue.h"
+#include "RateControl.h"
 
 //--- Declarations -----------------------------------------
 
 class Device;  // Forward declaration to prevent circular dependency
 
+//--- Types ------------------------------------------------
+
+struct LongMessage
+{
+  bool           active;                      // Waiting for the Relayer to get every fragment
+  char           type;                        // 'W' or 'S'
+  char           deviceID[ID_SIZE+1];
+  uint8_t        messageID;
+  uint8_t        count;                       // Number of fragments
+  uint16_t       acked;                       // Bitmap of the fragments the Relayer has (FACK)
+  int            numSends;                    // Times the fragments were sent
+  unsigned long  sendTime;                    // Time of the last send
+  int            length;
+  char           values[MAX_VALUES_LENGTH+1];
+};
+
 //==========================================================
 //  class Node
 //==========================================================
@@ -79,7 +166,7 @@ class Node
     int  deviceIndex = 0;
 
   protected:
-    char           nodeID[ID_SIZE+1];                                // This unique ID string ('00'-'19') is assigned at construction
+    char           nodeID[ID_SIZE+1];                                // This unique ID string ('00'-'99') is assigned at construction
     char           name[MAX_NAME_LENGTH+1] = "Node";                 // A display name to show in the SMAC Interface
     char           version[MAX_VERSION_LENGTH] = "";                 // A version number for this Node's firmware (yyyy.mm.dd<a-z>)
     char           macAddressString[MAC_STRING_SIZE+1] = "Not set";  // MAC address as a Hex string (xx:xx:xx:xx:xx:xx)
@@ -88,6 +175,59 @@ class Node
     char           *commandString;                                   // Command string from buffer
     unsigned long  lastPacketTime;                                   // Holds last Node communication time, used for keep alive
     ProcessStatus  pStatus;
+    SendQueue      outbox;                                           // Outgoing ESP-NOW messages with retries and delivery status
+    RateControl    rates;                                            // PHY rate to the Relayer and other Nodes (see RateControl.h)
+    int            deviceInfoIndex = -1;                             // Next Device to send DEINFO for (GDEI), -1 = none
+
+    //--- Peer directory (other Nodes' MAC addresses) ---
+    uint8_t        peerMACs[MAX_NODES][MAC_SIZE];
+    bool           peerKnown[MAX_NODES] = {};                        // MAC address is cached and added as an ESP-NOW peer
+    unsigned long  peerRequestTime[MAX_NODES] = {};                  // Time of the last directory request, 0 = never asked
+
+    //--- Broadcast command groups (JGRP) ---
+    bool           groupNode[MAX_GROUPS] = {};                       // This Node itself is a member
+    bool           groupDevices[MAX_GROUPS][MAX_DEVICES] = {};       // Member Devices of each group
+
+    //--- Emergency stop report, set by EStop() in the WiFi task ---
+    volatile bool      estopPending   = false;
+    volatile uint16_t  estopSeq       = 0;
+    char               estopDeviceID[ID_SIZE+1] = "--";
+    unsigned long      estopTime      = 0;
+
+    //--- WiFi channel switch (WFCH) and Relayer search ---
+    uint8_t        channel         = 1;                              // Current WiFi channel
+    uint8_t        pendingChannel  = 0;                              // Channel of a scheduled switch, 0 = none
+    unsigned long  switchTime      = 0;
+    uint32_t       lastDelivered   = 0;                              // outbox delivery count at the last Run
+    int            searchStep      = -1;                             // -1 = not searching, 0 = own channel, 1 = rendezvous, 2+ = every channel
+    unsigned long  searchStepTime  = 0;
+    unsigned long  lastSearchPing  = 0;
+
+#if MAX_FRAGMENTS > 1
+    //--- Long Data Strings sent in fragments ---
+    LongMessage    longMessages[LONG_MESSAGE_SLOTS] = {};
+    uint8_t        nextMessageID   = 0;
+#endif
+
+    //--- Congestion throttle (THRO) ---
+    float          throttle        = 1.0f;                           // Periodic processes run this many times slower
+    unsigned long  throttleTime    = 0;                              // Time of the last THRO from the Relayer
+
+    //--- Sleeping between transmissions (SetSleepy) ---
+    unsigned long  listenTime      = 0;                              // Millis listening after each frame, 0 = never sleep
+    bool           sleepyAnnounce  = false;                          // Tell the Relayer (SLEEPY=ms)
+    bool           dozing          = false;                          // Radio only listens in its wake windows
+
+    void  setChannel      (int newChannel);
+#if MAX_FRAGMENTS > 1
+    void  sendLong        (const char *sourceDeviceID, char type);
+    void  sendFragments   (LongMessage *message);
+#endif
+    void  requestPeer     (int peerIndex);
+    void  setPeer         (int peerIndex, const uint8_t *mac);
+    void  runGroupCommand (int groupIndex, char *command, char *params);
+    void  sleep           ();
+    void  doze            (bool on);
 
   public:
     Node (const char *inName, int inNodeID);
@@ -97,6 +237,10 @@ class Node
     void   SendData    (const char *sourceDeviceID, bool widgetData=true, bool broadcast=false);
     void   SendCommand (const char *targetNodeID, const char *targetDeviceID, const char *command, const char *params=NULL, bool broadcast=false);
     char * GetVersion  ();  // Return the current version of this Node
+    float  GetThrottle ();  // How many times slower periodic processes run (THRO from the Relayer)
+    void   SetSleepy   (unsigned long newListenTime=SLEEPY_LISTEN_TIME);  // Sleep between transmissions (0 = stay awake)
+    void   EStop       (const char *estopString);  // Called from ESPNOW_Receiver() for E|nn|dd|cccc|seq
+    void   FindRelayer ();  // Called repeatedly while WaitingForRelayer
 
     virtual ProcessStatus  ExecuteCommand (char *command, char *params=NULL);  // Override this method in a child Node class
 };
@@ -49,13 +49,13 @@ ThisNode::ThisNode ()
   goodToGo = false;
 
 
-  // SMAC Systems can have up to 20 Nodes.
-  // Set the Name and unique Node index for this Node (0-19).
+  // SMAC Systems can have up to 100 Nodes.
+  // Set the Name and unique Node index for this Node (0-99).
   // The Node indexes for a SMAC System with multiple Nodes must be unique and cannot be duplicated.
 
   //--- Create the Node Instance ---
   //                          ┌───────────── The Name of your Node
-  //                          │         ┌─── The Unique Node Index (0-19)
+  //                          │         ┌─── The Unique Node Index (0-99)
   //                          │         │
   thisNode = new Node ("My First Node", 0);
   if (thisNode == nullptr) return;
@@ -81,19 +81,13 @@ void setup()
     while (true);
   }
 
-  // PING the Relayer once per second until it responds with PONG
+  // PING the Relayer until it responds with PONG
+  // (trying other WiFi channels if it doesn't, see Node::FindRelayer)
   Serial.println ("PINGing Relayer ...");
-  strcpy (SMACData.values, "PING");
-  unsigned long  nowMillis, lastMillis = 0L;
   WaitingForRelayer = true;
   while (WaitingForRelayer)
   {
-    nowMillis = millis ();
-    if (nowMillis - lastMillis > 1000L)
-    {
-      lastMillis = nowMillis;
-      ThisNodeInstance->GetNode()->SendData ("--", false);
-    }
+    ThisNodeInstance->GetNode()->FindRelayer ();
 
     // Check for Set MAC Tool
     Serial_CheckInput ();
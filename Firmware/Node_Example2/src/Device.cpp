@@ -112,17 +112,30 @@ ProcessStatus Device::RunPeriodic ()
   // Do not override this method.
   // It is continually called by the Node to operate periodic processing.
 
+  // While the Relayer throttles the Nodes (THRO), the period is stretched
+  unsigned long period = (unsigned long)(processPeriod * node->GetThrottle ());
+
   // Is it time to do the periodic process?
   now = millis();
+  if (nextPeriodicTime > now + period)
+    nextPeriodicTime = now + period;  // A throttle was lifted; don't wait out the stretched period
+
   if (now >= nextPeriodicTime)
   {
-    nextPeriodicTime = now + processPeriod;
+    nextPeriodicTime = now + period;
     return DoPeriodic ();
   }
 
   return NODATA;
 }
 
+//--- GetNextTime -----------------------------------------
+
+unsigned long Device::GetNextTime ()
+{
+  return nextPeriodicTime;  // millis() of the next periodic process
+}
+
 //--- DoImmediate -----------------------------------------
 
 IRAM_ATTR ProcessStatus Device::DoImmediate ()
@@ -149,6 +162,38 @@ IRAM_ATTR ProcessStatus Device::DoPeriodic ()
   return NODATA;
 }
 
+//--- EStop -----------------------------------------------
+
+void Device::EStop ()
+{
+  // Override this method in your child class to stop the device immediately.
+  //
+  // It is called by the Node's loop (see RunEStop), so the Device's state
+  // can be changed here like in DoImmediate().
+}
+
+//--- LatchEStop ------------------------------------------
+
+void Device::LatchEStop ()
+{
+  // Called from the ESP-NOW receive callback (WiFi task):
+  // only latch the emergency stop, the loop runs EStop()
+  estopLatched = true;
+}
+
+//--- RunEStop --------------------------------------------
+
+bool Device::RunEStop ()
+{
+  // Run a latched emergency stop in the loop task
+  if (!estopLatched)
+    return false;
+
+  estopLatched = false;
+  EStop ();
+  return true;
+}
+
 //--- ExecuteCommand --------------------------------------
 
 ProcessStatus Device::ExecuteCommand (char *command, char *params)
@@ -34,6 +34,7 @@
 //                  72000 = 20 samples per second (recommended fastest data rate)
 //
 //                Use the SRAT command in ExecuteCommand() to set the periodic rate.
+//                While the SMAC network is congested, the Relayer slows every Device down for a while (see THRO in Node.h).
 //
 //              ∙ If either process has data to return, it should populate the global <SMACData.values>
 //                field, then return one of the <ProcessStatus> enums, usually WIDGET_DATA.
@@ -43,7 +44,8 @@
 //                  char  *nodeID            : 2-char nodeID (00-99)
 //                  char  *deviceID          : 2-char deviceID (00-99)
 //                  char  *command           : 4-char command (usually capital letters)
-//                  char  valuesORparams[..] : variable length values string (max 230 chars)
+//                  char  valuesORparams[..] : variable length values string (max MAX_VALUES_LENGTH chars,
+//                                             MAX_FRAME_VALUES unless built with MAX_FRAGMENTS > 1)
 //                                             This can be a numerical value or a text/error message
 //                                             Multiple values can be separated with commas
 //
@@ -58,7 +60,7 @@
 //                separated with the '|' char:
 //
 //                  ┌───────────────── 1-char packet type ('C' for Command)
-//                  │ ┌─────────────── 2-char nodeID (00-19)
+//                  │ ┌─────────────── 2-char nodeID (00-99)
 //                  │ │  ┌──────────── 2-char deviceID (00-99)
 //                  │ │  │   ┌──────── 4-char command (usually capital letters)
 //                  │ │  │   │     ┌── Optional variable length parameter string
@@ -87,6 +89,12 @@
 //                  Device::ExecuteCommand(...)
 //                If the command is not handled by this base class, you can handle the command in your derived class.
 //
+//            █ Devices that move or drive something should override the virtual EStop() method.
+//              An emergency stop (E|nn|dd|cccc) is latched by the ESP-NOW receive callback and
+//              EStop() is called by the Node's loop ahead of everything else, and again ahead of
+//              DoImmediate(), so a step or ramp in progress can't undo it.  Keep it short:
+//              set outputs and state only.
+//
 //   AUTHOR : Bill Daniels
 //            Copyright 2021-2026, D+S Tech Labs, Inc.
 //            All Rights Reserved
@@ -120,6 +128,7 @@ class Device
     bool           periodicEnabled  = true;             // true to have DoPeriodic called at the process period
     unsigned long  processPeriod    = 1000L;            // milliseconds; default is 1 process per second
     unsigned long  nextPeriodicTime = 0L;               // Next time to do the periodic process
+    volatile bool  estopLatched     = false;            // Emergency stop received, EStop() not run yet
     unsigned long  now;
     ProcessStatus  pStatus;
 
@@ -137,10 +146,14 @@ class Device
     char *         GetVersion  ();                  // Return the current version of this Device
 
     ProcessStatus  RunPeriodic ();  // No need to use this method. It is called by the Node.
+    unsigned long  GetNextTime ();  // No need to use this method. It is called by a sleepy Node.
+    void           LatchEStop  ();  // No need to use this method. It is called by the Node's ESP-NOW receiver.
+    bool           RunEStop    ();  // No need to use this method. It is called by the Node.
 
     virtual ProcessStatus  DoImmediate    ();                                  // Override this method for processing your device continuously
     virtual ProcessStatus  DoPeriodic     ();                                  // Override this method for processing your device periodically
     virtual ProcessStatus  ExecuteCommand (char *command, char *params=NULL);  // Override this method to handle custom commands
+    virtual void           EStop          ();                                  // Override this method to stop your device immediately
 };
 
 #endif
@@ -23,7 +23,7 @@
 
 #define SERIAL_BAUDRATE      115200
 #define SERIAL_MAX_LENGTH        80
-#define MAX_NODES                20  // Maximum number of ESP-NOW peers
+#define MAX_NODES               100  // Maximum number of Nodes (nodeIDs 00-99)
 #define MAX_DEVICES             100  // Maximum number of Devices that can connect to a Node
 #define MAC_SIZE                  6  // Size of ESP32 MAC Address
 #define ID_SIZE                   2  // Number of chars in nodeID and deviceID
@@ -33,8 +33,41 @@
 #define MAX_VERSION_LENGTH       10  // Suggested format: MM.mm.pp (Major.minor.patch)
 #define MAX_NAME_LENGTH          32
 #define MAX_ESPNOW_LENGTH       250  // Max message size for ESP-NOW protocol
-#define MAX_VALUES_LENGTH       230  // Need to leave room for appended timestamp
-#define MAX_SILENT_DURATION   30000  // Maximum millis of silence while testing for dead Node
+#define MAX_FRAME_VALUES        230  // Values that fit in one frame (need to leave room for appended timestamp)
+#define FRAGMENT_CHUNK          220  // Values carried by each fragment (must match Relayer.h)
+
+// Long values are off by default.  Build with MAX_FRAGMENTS 2 or more (no more than the Relayer's)
+// to send them in fragments; each fragment costs about 3*FRAGMENT_CHUNK bytes of RAM.
+#ifndef MAX_FRAGMENTS
+#define MAX_FRAGMENTS             1  // Most ESP-NOW fragments of one long Data String
+#endif
+
+#if MAX_FRAGMENTS > 1
+#define MAX_VALUES_LENGTH      (MAX_FRAGMENTS*FRAGMENT_CHUNK)  // Longer than MAX_FRAME_VALUES is sent in fragments
+#define LONG_MESSAGE_SLOTS        2  // Long Data Strings waiting for the Relayer's FACK at the same time
+#else
+#define MAX_VALUES_LENGTH      MAX_FRAME_VALUES
+#endif
+#define FRAGMENT_RETRY_TIME     300  // Millis without a FACK before the missing fragments are sent again
+#define FRAGMENT_MAX_RETRIES      5
+#define MAX_SILENT_DURATION   10000  // Millis of silence before an idle Node sends a heartbeat (must match Relayer.h)
+#define HEARTBEAT_VALUE        "HB"  // Heartbeat: S|nn|--|HB (must match Relayer.h)
+#define THROTTLE_MAX_FACTOR      16  // Most the Relayer can slow down periodic processing (must match Relayer.h)
+#define THROTTLE_HOLD_TIME     6000  // Millis a throttle from the Relayer lasts unless it is repeated
+#define SLEEPY_LISTEN_TIME      100  // Default millis a sleepy Node listens after each frame (see Node::SetSleepy)
+#define SLEEPY_MIN_SLEEP         20  // Shortest idle time worth dozing for (millis)
+#define SLEEPY_STEP              50  // Millis between checks for a Command while dozing
+#define SLEEPY_WAKE_INTERVAL   1000  // Millis between the radio's wake windows while a sleepy Node dozes
+#define SLEEPY_WAKE_WINDOW       20  // Millis the radio listens in each wake window
+#define PEER_REQUEST_INTERVAL  5000  // Minimum millis between peer directory requests for the same Node
+#define MAX_GROUPS               10  // Broadcast command groups G0-G9 (set up by the Relayer)
+#define ESTOP_REPEAT_TIME      1000  // Millis an emergency stop with the same seq is a repeated copy
+#define MAX_CHANNEL              13  // WiFi channels 1-13
+#define RENDEZVOUS_CHANNEL        1  // The Relayer announces its channel here after a switch (must match Relayer.h)
+#define RENDEZVOUS_WAIT        3000  // Millis waiting on the rendezvous channel while looking for the Relayer
+#define RELAYER_LOST_FAILURES     3  // Messages lost to the Relayer, with none delivered, before looking for it
+#define CHANNEL_SEARCH_DWELL    300  // Millis PINGing the Relayer on each channel while looking for it
+#define CHANNEL_SEARCH_PING     100  // Millis between PINGs while looking for the Relayer
 
 //--- Types -----------------------------------------------
 
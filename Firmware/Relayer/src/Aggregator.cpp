@@ -0,0 +1,199 @@
+//=========================================================
+//
+//     FILE : Aggregator.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Aggregator class:
+//            Thins out fast Widget Data streams before they are sent to the Interface.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Aggregator.h"
+
+//--- Constructor -----------------------------------------
+
+Aggregator::Aggregator ()
+{
+  memset (streams, 0, sizeof(streams));
+}
+
+//--- SetPolicy -------------------------------------------
+
+bool Aggregator::SetPolicy (int nodeIndex, int deviceIndex, AggMode mode, uint32_t setting)
+{
+  AggStream *stream = Find (nodeIndex, deviceIndex);
+
+  // Pass-through is the same as no policy
+  if (mode == AGG_PASS)
+  {
+    if (stream != NULL)
+      stream->inUse = false;
+
+    return true;
+  }
+
+  for (int i=0; i<AGG_SLOTS && stream == NULL; i++)
+    if (!streams[i].inUse)
+      stream = &streams[i];
+
+  if (stream == NULL)
+    return false;
+
+  memset (stream, 0, sizeof(AggStream));
+  stream->inUse       = true;
+  stream->nodeIndex   = nodeIndex;
+  stream->deviceIndex = deviceIndex;
+  stream->mode        = mode;
+  stream->setting     = setting;
+
+  return true;
+}
+
+//--- Find ------------------------------------------------
+
+AggStream *Aggregator::Find (int nodeIndex, int deviceIndex)
+{
+  for (int i=0; i<AGG_SLOTS; i++)
+    if (streams[i].inUse && streams[i].nodeIndex == nodeIndex && streams[i].deviceIndex == deviceIndex)
+      return &streams[i];
+
+  return NULL;
+}
+
+//--- GetStream -------------------------------------------
+
+AggStream *Aggregator::GetStream (int slot)
+{
+  return (slot >= 0 && slot < AGG_SLOTS && streams[slot].inUse) ? &streams[slot] : NULL;
+}
+
+//--- Add -------------------------------------------------
+
+bool Aggregator::Add (AggStream *stream, const char *values, int64_t timestamp)
+{
+  ++stream->numIn;
+
+  if (fullRate)
+  {
+    ++stream->numOut;
+    return true;
+  }
+
+  //--- Decimate ---
+  if (stream->mode == AGG_DECIMATE)
+  {
+    if (stream->count++ % stream->setting != 0)
+      return false;
+
+    ++stream->numOut;
+    return true;
+  }
+
+  //--- Mean, Min/Mean/Max ---
+  float  newValues[AGG_MAX_VALUES];
+  int    numValues = 0;
+
+  const char *next = values;
+  while (true)
+  {
+    char  *end;
+    float  value = strtof (next, &end);
+
+    // Values that aren't numbers, or too many of them, can't be aggregated
+    if (end == next || (*end != ',' && *end != 0) || numValues >= AGG_MAX_VALUES)
+    {
+      ++stream->numOut;
+      return true;
+    }
+
+    newValues[numValues++] = value;
+    if (*end == 0) break;
+    next = end + 1;
+  }
+
+  // A different number of values starts a new window
+  if (stream->count > 0 && numValues != stream->numValues)
+    stream->count = 0;
+
+  if (stream->count == 0)
+  {
+    stream->numValues   = numValues;
+    stream->windowStart = timestamp;
+
+    for (int i=0; i<numValues; i++)
+    {
+      stream->sum[i] = 0.0f;
+      stream->min[i] = newValues[i];
+      stream->max[i] = newValues[i];
+    }
+  }
+
+  for (int i=0; i<numValues; i++)
+  {
+    stream->sum[i] += newValues[i];
+    if (newValues[i] < stream->min[i]) stream->min[i] = newValues[i];
+    if (newValues[i] > stream->max[i]) stream->max[i] = newValues[i];
+  }
+
+  ++stream->count;
+  stream->lastTime = timestamp;
+
+  return false;
+}
+
+//--- IsDue -----------------------------------------------
+
+bool Aggregator::IsDue (AggStream *stream, int64_t now)
+{
+  if (stream->mode == AGG_DECIMATE || stream->count == 0)
+    return false;
+
+  // Whatever is left in a window goes out right away once full rate is on
+  return (fullRate || now - stream->windowStart >= (int64_t) stream->setting);
+}
+
+//--- TakeRecord ------------------------------------------
+
+int Aggregator::TakeRecord (AggStream *stream, char *record)
+{
+  // W|nn|dd|mean,mean,...  or  W|nn|dd|min,mean,max,min,mean,max,...
+  // <record> must hold MAX_ESPNOW_LENGTH+1 chars
+  int length = sprintf (record, "W|%02d|%02d|", stream->nodeIndex, stream->deviceIndex);
+
+  for (int i=0; i<stream->numValues; i++)
+  {
+    float mean = stream->sum[i] / (float) stream->count;
+
+    if (stream->mode == AGG_MIN_MEAN_MAX)
+      length += sprintf (record + length, (i == 0) ? "%.5g,%.5g,%.5g" : ",%.5g,%.5g,%.5g", stream->min[i], mean, stream->max[i]);
+    else
+      length += sprintf (record + length, (i == 0) ? "%.6g" : ",%.6g", mean);
+  }
+
+  stream->count = 0;
+  ++stream->numOut;
+
+  return length;
+}
+
+//--- SetFullRate -----------------------------------------
+
+void Aggregator::SetFullRate (bool on)
+{
+  fullRate = on;
+}
+
+//--- IsFullRate ------------------------------------------
+
+bool Aggregator::IsFullRate ()
+{
+  return fullRate;
+}
@@ -0,0 +1,104 @@
+//=========================================================
+//
+//     FILE : Aggregator.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Aggregator class:
+//            Thins out fast Widget Data streams before they are sent to the Interface.
+//
+//            █ A policy is set for each (Node, Device) stream with the SAGG command:
+//
+//                C|--|--|SAGG|nn.dd,PASS      Send every Data String (removes the policy)
+//                C|--|--|SAGG|nn.dd,DEC,n     Send every n-th Data String
+//                C|--|--|SAGG|nn.dd,AVG,ms    Send the mean of each value every ms milliseconds
+//                C|--|--|SAGG|nn.dd,MMM,ms    Send min,mean,max of each value every ms milliseconds
+//
+//              The reply is S|--|--|AGG=nn.dd,mode,setting.
+//              GAGG lists all policies with their counters:
+//
+//                S|--|--|AGG=nn.dd,mode,setting,stringsIn,stringsOut
+//
+//            █ Only Widget Data ('W') is aggregated.  System Data always passes.
+//              Data Strings with values that aren't numbers also pass unchanged.
+//
+//            █ An aggregated Data String keeps the usual W|nn|dd|values format, with the
+//              capture time of the last Data String in its window.  For MMM, each value
+//              becomes three values: min,mean,max.
+//
+//            █ FULL|1 sends every Data String at full rate (e.g. while data logging)
+//              without forgetting the policies; FULL|0 applies them again.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define AGG_SLOTS           32  // Streams that can have a policy
+#define AGG_MAX_VALUES       6  // Values per Data String that can be aggregated (MMM triples them)
+#define AGG_MIN_WINDOW      10  // Shortest window (milliseconds)
+
+//--- Types -----------------------------------------------
+
+enum AggMode
+{
+  AGG_PASS,
+  AGG_DECIMATE,
+  AGG_MEAN,
+  AGG_MIN_MEAN_MAX
+};
+
+struct AggStream
+{
+  bool      inUse;
+  int8_t    nodeIndex;
+  int8_t    deviceIndex;
+  AggMode   mode;
+  uint32_t  setting;                    // DECIMATE: n, MEAN/MIN_MEAN_MAX: window (microseconds)
+  uint32_t  count;                      // Data Strings since the last one sent, or in this window
+  int64_t   windowStart;                // Capture time of the first Data String in this window
+  int64_t   lastTime;                   // Capture time of the last Data String in this window
+  int       numValues;
+  float     sum[AGG_MAX_VALUES];
+  float     min[AGG_MAX_VALUES];
+  float     max[AGG_MAX_VALUES];
+  uint32_t  numIn;                      // Data Strings received
+  uint32_t  numOut;                     // Data Strings sent to the Interface
+};
+
+
+//=========================================================
+//  class Aggregator
+//=========================================================
+
+class Aggregator
+{
+  protected:
+    AggStream  streams[AGG_SLOTS];
+    bool       fullRate = false;
+
+  public:
+    Aggregator ();
+
+    bool        SetPolicy   (int nodeIndex, int deviceIndex, AggMode mode, uint32_t setting);  // false if no free slot
+    AggStream  *Find        (int nodeIndex, int deviceIndex);  // NULL = pass everything
+    AggStream  *GetStream   (int slot);                        // NULL if the slot is free
+    bool        Add         (AggStream *stream, const char *values, int64_t timestamp);  // true = send this Data String as is
+    bool        IsDue       (AggStream *stream, int64_t now);  // Window is over and has Data Strings
+    int         TakeRecord  (AggStream *stream, char *record); // Build the window's Data String and start a new window
+    void        SetFullRate (bool on);
+    bool        IsFullRate  ();
+};
+
+#endif
@@ -0,0 +1,169 @@
+//=========================================================
+//
+//     FILE : GroupTable.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : GroupTable class:
+//            Holds the named groups of (Node, Device) pairs that can be
+//            commanded together with a single broadcast frame.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "GroupTable.h"
+
+//--- Declarations ----------------------------------------
+
+int ParseID (const char *id);
+
+//--- Constructor -----------------------------------------
+
+GroupTable::GroupTable ()
+{
+  memset (groups, 0, sizeof(groups));
+}
+
+//--- Find ------------------------------------------------
+
+int GroupTable::Find (const char *name)
+{
+  for (int i=0; i<MAX_GROUPS; i++)
+    if (groups[i].defined && strcmp (groups[i].name, name) == 0)
+      return i;
+
+  return -1;
+}
+
+//--- Define ----------------------------------------------
+
+int GroupTable::Define (const char *name, const char *memberList)
+{
+  // <memberList> is "nn.dd,nn.dd,..."
+  if (strlen (name) < 1 || strlen (name) > GROUP_NAME_LENGTH)
+    return -1;
+
+  Group  newGroup = {};
+  strcpy (newGroup.name, name);
+  newGroup.defined = true;
+
+  const char *member = memberList;
+  while (*member != 0)
+  {
+    // Each member is exactly nn.dd
+    if (newGroup.numMembers >= MAX_GROUP_MEMBERS || strlen (member) < 5 || member[2] != '.' || (member[5] != ',' && member[5] != 0))
+      return -1;
+
+    int nodeIndex   = ParseID (member);
+    int deviceIndex = (member[3] == '-' && member[4] == '-') ? -1 : ParseID (member + 3);
+    if (nodeIndex < 0 || nodeIndex >= MAX_NODES || deviceIndex < -1)
+      return -1;
+
+    newGroup.members[newGroup.numMembers].nodeIndex   = nodeIndex;
+    newGroup.members[newGroup.numMembers].deviceIndex = deviceIndex;
+    ++newGroup.numMembers;
+
+    member += (member[5] == ',') ? 6 : 5;
+  }
+
+  if (newGroup.numMembers == 0)
+    return -1;
+
+  // Replace the group of the same name, or take the first free one
+  int groupIndex = Find (name);
+  for (int i=0; i<MAX_GROUPS && groupIndex < 0; i++)
+    if (!groups[i].defined)
+      groupIndex = i;
+
+  if (groupIndex >= 0)
+    groups[groupIndex] = newGroup;
+
+  return groupIndex;
+}
+
+//--- Remove ----------------------------------------------
+
+void GroupTable::Remove (int groupIndex)
+{
+  if (IsDefined (groupIndex))
+    memset (&groups[groupIndex], 0, sizeof(Group));
+}
+
+//--- IsDefined -------------------------------------------
+
+bool GroupTable::IsDefined (int groupIndex)
+{
+  return (groupIndex >= 0 && groupIndex < MAX_GROUPS && groups[groupIndex].defined);
+}
+
+//--- GetGroup --------------------------------------------
+
+Group *GroupTable::GetGroup (int groupIndex)
+{
+  return IsDefined (groupIndex) ? &groups[groupIndex] : NULL;
+}
+
+//--- HasNode ---------------------------------------------
+
+bool GroupTable::HasNode (int groupIndex, int nodeIndex)
+{
+  if (!IsDefined (groupIndex))
+    return false;
+
+  for (int i=0; i<groups[groupIndex].numMembers; i++)
+    if (groups[groupIndex].members[i].nodeIndex == nodeIndex)
+      return true;
+
+  return false;
+}
+
+//--- GetDeviceList ---------------------------------------
+
+int GroupTable::GetDeviceList (int groupIndex, int nodeIndex, char *list)
+{
+  // <list> must hold 3 chars per member
+  int count = 0;
+  list[0] = 0;
+
+  if (!IsDefined (groupIndex))
+    return 0;
+
+  for (int i=0; i<groups[groupIndex].numMembers; i++)
+  {
+    GroupMember *member = &groups[groupIndex].members[i];
+    if (member->nodeIndex != nodeIndex)
+      continue;
+
+    if (member->deviceIndex < 0)
+      sprintf (list, (count == 0) ? "--" : ",--");
+    else
+      sprintf (list, (count == 0) ? "%02d" : ",%02d", member->deviceIndex);
+
+    list += strlen (list);
+    ++count;
+  }
+
+  return count;
+}
+
+
+//=========================================================
+// External "C" Functions
+//=========================================================
+
+//--- ParseID ---------------------------------------------
+
+int ParseID (const char *id)
+{
+  // Two-digit nodeID or deviceID, -1 if not digits
+  if (!isdigit (id[0]) || !isdigit (id[1]))
+    return -1;
+
+  return 10*(id[0]-'0') + (id[1]-'0');
+}
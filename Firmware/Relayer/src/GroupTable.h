@@ -0,0 +1,88 @@
+//=========================================================
+//
+//     FILE : GroupTable.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : GroupTable class:
+//            Holds the named groups of (Node, Device) pairs that can be
+//            commanded together with a single broadcast frame.
+//
+//            █ Groups are set up at runtime by the Interface:
+//
+//                C|--|--|SGRP|name,nn.dd,nn.dd,...  -->  S|--|--|GROUP=name,Gg,numMembers
+//                C|--|--|DGRP|name                  -->  S|--|--|GROUP=name,deleted
+//                C|--|--|GGRP                       -->  S|--|--|GROUP=name,Gg,nn.dd,nn.dd,...  (one line per group)
+//
+//              A member's deviceID may be "--" for the Node itself.  Redefining a group
+//              replaces all of its members.
+//
+//            █ The Relayer tells every member Node which of its Devices belong to the group:
+//
+//                C|nn|--|JGRP|g,dd,dd,...   (just "g" to leave the group)
+//
+//              and tells it again whenever the Node (re)registers with a PING.
+//
+//            █ A command to a group, C|Gg|--|cccc|params, is broadcast once and executed
+//              by every member at the same time.  Nodes that are not members ignore it.
+//              C|--|dd|cccc|params is broadcast to all Nodes.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef GROUPTABLE_H
+#define GROUPTABLE_H
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define MAX_GROUPS          10  // Groups G0-G9
+#define MAX_GROUP_MEMBERS   32  // (Node, Device) pairs per group
+#define GROUP_NAME_LENGTH   16
+
+//--- Types -----------------------------------------------
+
+struct GroupMember
+{
+  int8_t  nodeIndex;
+  int8_t  deviceIndex;  // -1 = the Node itself
+};
+
+struct Group
+{
+  bool         defined;
+  char         name[GROUP_NAME_LENGTH+1];
+  int          numMembers;
+  GroupMember  members[MAX_GROUP_MEMBERS];
+};
+
+
+//=========================================================
+//  class GroupTable
+//=========================================================
+
+class GroupTable
+{
+  protected:
+    Group  groups[MAX_GROUPS];
+
+  public:
+    GroupTable ();
+
+    int     Find          (const char *name);  // Group index, -1 if not defined
+    int     Define        (const char *name, const char *memberList);  // Group index, -1 if invalid or no free group
+    void    Remove        (int groupIndex);
+    bool    IsDefined     (int groupIndex);
+    Group  *GetGroup      (int groupIndex);
+    bool    HasNode       (int groupIndex, int nodeIndex);
+    int     GetDeviceList (int groupIndex, int nodeIndex, char *list);  // "dd,dd,..." of a Node's members, returns count
+};
+
+#endif
@@ -0,0 +1,187 @@
+//=========================================================
+//
+//     FILE : LineQueue.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Implements a fixed-slot, lock-free, single-producer/single-consumer
+//            queue of text lines between the Relayer's two tasks.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "LineQueue.h"
+
+//--- Constructor -----------------------------------------
+
+LineQueue::LineQueue ()
+{
+  headIndex  = 0;
+  tailIndex  = 0;
+  numDropped = 0;
+  highWater  = 0;
+  consumer   = NULL;
+}
+
+//--- SetConsumer -----------------------------------------
+
+void LineQueue::SetConsumer (TaskHandle_t task)
+{
+  consumer = task;
+}
+
+//--- Push ------------------------------------------------
+
+bool LineQueue::Push (const char *text, int length, bool hasTimestamp, int64_t timestamp, bool isCommand)
+{
+  Line *line = claim ();
+  if (line == NULL)
+    return false;
+
+  if (length < 0) length = 0;
+  if (length > MAX_ESPNOW_LENGTH) length = MAX_ESPNOW_LENGTH;
+
+  line->hasTimestamp = hasTimestamp;
+  line->isCommand    = isCommand;
+  line->timestamp    = timestamp;
+  line->length       = length;
+  line->longText     = NULL;
+  line->busy         = NULL;
+  memcpy (line->text, text, length);
+  line->text[length] = 0;
+
+  publish ();
+  return true;
+}
+
+//--- SendLine --------------------------------------------
+
+void LineQueue::SendLine (const char *text)
+{
+  Push (text, strlen (text), false, 0);
+}
+
+//--- SendString ------------------------------------------
+
+void LineQueue::SendString (const char *text, int length, int64_t timestamp)
+{
+  Push (text, length, true, timestamp);
+}
+
+//--- SendCommand -----------------------------------------
+
+void LineQueue::SendCommand (const char *text, int length)
+{
+  Push (text, length, false, 0, true);
+}
+
+//--- SendLong --------------------------------------------
+
+bool LineQueue::SendLong (const char *text, int length, int64_t timestamp, volatile bool *busy)
+{
+  Line *line = claim ();
+  if (line == NULL)
+    return false;
+
+  // The text stays with the producer until the consumer has written it
+  *busy = true;
+  line->hasTimestamp = true;
+  line->isCommand    = false;
+  line->timestamp    = timestamp;
+  line->length       = length;
+  line->longText     = text;
+  line->busy         = busy;
+  line->text[0]      = 0;
+
+  publish ();
+  return true;
+}
+
+//--- claim -----------------------------------------------
+
+Line *LineQueue::claim ()
+{
+  uint32_t tail  = tailIndex.load (std::memory_order_relaxed);
+  uint32_t depth = tail - headIndex.load (std::memory_order_acquire);
+
+  // Give the consumer a little time to catch up
+  for (int waited=0; depth >= LINE_QUEUE_SLOTS; waited++)
+  {
+    if (waited >= LINE_QUEUE_WAIT)
+    {
+      ++numDropped;
+      return NULL;
+    }
+
+    vTaskDelay (pdMS_TO_TICKS (1));
+    depth = tail - headIndex.load (std::memory_order_acquire);
+  }
+
+  return &slots[tail & (LINE_QUEUE_SLOTS - 1)];
+}
+
+//--- publish ---------------------------------------------
+
+void LineQueue::publish ()
+{
+  // Give the claimed slot to the consumer
+  uint32_t tail  = tailIndex.load (std::memory_order_relaxed) + 1;
+  uint32_t depth = tail - headIndex.load (std::memory_order_acquire);
+
+  tailIndex.store (tail, std::memory_order_release);
+
+  if (depth > highWater)
+    highWater = depth;
+
+  if (consumer != NULL)
+    xTaskNotifyGive (consumer);
+}
+
+//--- Peek ------------------------------------------------
+
+Line *LineQueue::Peek ()
+{
+  uint32_t head = headIndex.load (std::memory_order_relaxed);
+
+  if (head == tailIndex.load (std::memory_order_acquire))
+    return NULL;  // Empty
+
+  return &slots[head & (LINE_QUEUE_SLOTS - 1)];
+}
+
+//--- Pop -------------------------------------------------
+
+void LineQueue::Pop ()
+{
+  uint32_t head = headIndex.load (std::memory_order_relaxed);
+
+  if (head != tailIndex.load (std::memory_order_acquire))
+    headIndex.store (head + 1, std::memory_order_release);  // Give the slot back to the producer
+}
+
+//--- GetDepth --------------------------------------------
+
+int LineQueue::GetDepth ()
+{
+  return (int)(tailIndex.load (std::memory_order_acquire) - headIndex.load (std::memory_order_acquire));
+}
+
+//--- GetDropped ------------------------------------------
+
+uint32_t LineQueue::GetDropped ()
+{
+  return numDropped;
+}
+
+//--- GetHighWater ----------------------------------------
+
+uint32_t LineQueue::GetHighWater ()
+{
+  return highWater;
+}
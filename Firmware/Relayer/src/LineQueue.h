@@ -0,0 +1,94 @@
+//=========================================================
+//
+//     FILE : LineQueue.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Implements a fixed-slot, lock-free, single-producer/single-consumer
+//            queue of text lines between the Relayer's two tasks (see Relayer.h).
+//
+//            █ FromInterface : Command Strings parsed by the serial task for the radio task.
+//
+//            █ ToInterface   : Relayer messages and Data Strings (with their capture time)
+//                              from the radio task, formatted and written by the serial task.
+//
+//            █ SendLine() and SendString() match the Uplink methods, so the radio task
+//              sends to the Interface the same way as before.  If the queue is full, the
+//              producer waits up to LINE_QUEUE_WAIT milliseconds, then drops the line.
+//
+//            █ SendCommand() hands a serial link command (GMAC, GTXQ, GPIP, SBAU, STIM, SUPM)
+//              back to the serial task.  It is run when the consumer reaches it, so its reply
+//              goes out in order with the lines queued before it.
+//
+//            █ SendLong() queues a reassembled Data String that is too long for a slot
+//              (see Reassembler.h).  Only a pointer is queued; the consumer clears <*busy>
+//              once it has written the text, so the producer must not change it until then.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef LINEQUEUE_H
+#define LINEQUEUE_H
+
+//--- Includes --------------------------------------------
+
+#include <atomic>
+#include <Arduino.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define LINE_QUEUE_SLOTS  64  // Number of line slots (must be a power of 2)
+#define LINE_QUEUE_WAIT   20  // Milliseconds a producer waits for a free slot
+
+//--- Types -----------------------------------------------
+
+struct Line
+{
+  bool     hasTimestamp;                // Data String to relay with its capture time
+  bool     isCommand;                   // Serial link command for the consumer to run (see SendCommand)
+  int64_t  timestamp;                   // Capture time (microseconds since boot)
+  int      length;                      // Number of chars in text
+  char     text[MAX_ESPNOW_LENGTH+1];   // Always NULL terminated
+  const char     *longText;             // Text of a long Data String, instead of <text>
+  volatile bool  *busy;                 // Cleared by the consumer when <longText> is written
+};
+
+
+//=========================================================
+//  class LineQueue
+//=========================================================
+
+class LineQueue
+{
+  protected:
+    Line                   slots[LINE_QUEUE_SLOTS];
+    std::atomic<uint32_t>  headIndex;   // Next slot to read  (only changed by the consumer)
+    std::atomic<uint32_t>  tailIndex;   // Next slot to write (only changed by the producer)
+    volatile uint32_t      numDropped;  // Lines dropped because the queue stayed full
+    volatile uint32_t      highWater;   // Largest number of lines ever waiting
+    TaskHandle_t           consumer;    // Task to wake when a line is pushed
+
+    Line  *claim   ();  // Wait for a free slot, NULL if the queue stayed full
+    void   publish ();  // Give the claimed slot to the consumer
+
+  public:
+    LineQueue ();
+
+    void      SetConsumer  (TaskHandle_t task);
+    bool      Push         (const char *text, int length, bool hasTimestamp, int64_t timestamp, bool isCommand=false);  // Producer only
+    void      SendLine     (const char *text);                                   // Producer only
+    void      SendString   (const char *text, int length, int64_t timestamp);   // Producer only
+    void      SendCommand  (const char *text, int length);                       // Producer only
+    bool      SendLong     (const char *text, int length, int64_t timestamp, volatile bool *busy);  // Producer only
+    Line     *Peek         ();  // Consumer only: oldest line or NULL, valid until Pop()
+    void      Pop          ();  // Consumer only: release the oldest line
+    int       GetDepth     ();
+    uint32_t  GetDropped   ();
+    uint32_t  GetHighWater ();
+};
+
+#endif
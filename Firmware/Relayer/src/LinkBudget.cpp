@@ -0,0 +1,142 @@
+//=========================================================
+//
+//     FILE : LinkBudget.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : LinkBudget class:
+//            Keeps the periodic Widget Data of all Devices within the airtime of the
+//            WiFi channel and the bandwidth of the serial link to the Interface.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "LinkBudget.h"
+
+//--- Constructor -----------------------------------------
+
+LinkBudget::LinkBudget (TwinTable *deviceTwins)
+{
+  twins = deviceTwins;
+
+#ifdef HOST_LINK_USB
+  serialBytes = BUDGET_USB_BYTES;
+#else
+  serialBytes = SERIAL_BAUDRATE / 10;  // 8N1
+#endif
+}
+
+//--- SetLimits -------------------------------------------
+
+void LinkBudget::SetLimits (int airPercent, int serialPercent, BudgetMode newMode)
+{
+  if (airPercent    <   1) airPercent    =   1;
+  if (airPercent    > 100) airPercent    = 100;
+  if (serialPercent <   1) serialPercent =   1;
+  if (serialPercent > 100) serialPercent = 100;
+
+  airLimit    = airPercent;
+  serialLimit = serialPercent;
+  mode        = newMode;
+}
+
+//--- SetSerialRate ---------------------------------------
+
+void LinkBudget::SetSerialRate (uint32_t baudRate)
+{
+#ifndef HOST_LINK_USB
+  serialBytes = baudRate / 10;
+#endif
+}
+
+//--- GetLoad ---------------------------------------------
+
+void LinkBudget::GetLoad (BudgetLoad *load, int skipNode, int skipDevice)
+{
+  load->airtime = 0;
+  load->serial  = 0;
+
+  for (int n=0; n<MAX_NODES; n++)
+  {
+    NodeTwin *node = twins->GetNode (n);
+    if (node == NULL)
+      continue;
+
+    for (int d=0; d<TWIN_MAX_DEVICES; d++)
+    {
+      DeviceTwin *device = node->devices[d];
+      if (device == NULL || !device->ppEnabled || (n == skipNode && d == skipDevice))
+        continue;
+
+      addDevice (load, device, device->rate / 3600.0f);
+    }
+  }
+}
+
+//--- MaxRate ---------------------------------------------
+
+unsigned long LinkBudget::MaxRate (int nodeIndex, int deviceIndex)
+{
+  // What is left by all the other Devices, divided by the cost of one frame of this Device
+  BudgetLoad  others, perFrame = { 0, 0 };
+
+  GetLoad   (&others, nodeIndex, deviceIndex);
+  addDevice (&perFrame, twins->GetDevice (nodeIndex, deviceIndex), 1.0f);
+
+  float airLeft    = airLimit    / 100.0f - others.airtime;
+  float serialLeft = serialLimit / 100.0f - others.serial;
+  if (airLeft <= 0 || serialLeft <= 0)
+    return 0;
+
+  float framesPerSecond = airLeft / perFrame.airtime;
+  if (serialLeft / perFrame.serial < framesPerSecond)
+    framesPerSecond = serialLeft / perFrame.serial;
+
+  return (unsigned long)(framesPerSecond * 3600.0f);
+}
+
+//--- GetAirLimit -----------------------------------------
+
+int LinkBudget::GetAirLimit ()
+{
+  return airLimit;
+}
+
+//--- GetSerialLimit --------------------------------------
+
+int LinkBudget::GetSerialLimit ()
+{
+  return serialLimit;
+}
+
+//--- GetMode ---------------------------------------------
+
+BudgetMode LinkBudget::GetMode ()
+{
+  return mode;
+}
+
+//--- GetModeName -----------------------------------------
+
+const char *LinkBudget::GetModeName (BudgetMode budgetMode)
+{
+  static const char *names[] = { "CLAMP", "REJECT", "OFF" };
+  return names[budgetMode];
+}
+
+//--- addDevice -------------------------------------------
+
+void LinkBudget::addDevice (BudgetLoad *load, DeviceTwin *device, float framesPerSecond)
+{
+  int airtime = (device != NULL && device->avgAirtime > 0) ? device->avgAirtime : BUDGET_DEFAULT_AIRTIME;
+  int length  = (device != NULL && device->avgLength  > 0) ? device->avgLength  : BUDGET_DEFAULT_LENGTH;
+
+  load->airtime += framesPerSecond * (airtime + BUDGET_ACK_TIME) / 1000000.0f;
+  load->serial  += framesPerSecond * (length + BUDGET_RECORD_OVERHEAD) / (float) serialBytes;
+}
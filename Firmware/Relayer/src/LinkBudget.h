@@ -0,0 +1,104 @@
+//=========================================================
+//
+//     FILE : LinkBudget.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : LinkBudget class:
+//            Keeps the periodic Widget Data of all Devices within the airtime of the
+//            WiFi channel and the bandwidth of the serial link to the Interface.
+//
+//            █ The load is built from the Device twins (see TwinTable.h): every Device with
+//              Periodic Processing enabled sends <rate> frames per hour, each costing the
+//              average airtime (plus its ACK) and serial bytes seen for that Device.
+//              Devices not seen yet are counted with BUDGET_DEFAULT_AIRTIME and BUDGET_DEFAULT_LENGTH.
+//
+//            █ A new rate for a Device (C|nn|dd|SRAT|rate) is checked before it is relayed.
+//              If it would take more than the budget:
+//
+//                CLAMP  : the rate is lowered to what fits  -->  S|nn|dd|BUDGET=CLAMPED,requested,allowed
+//                REJECT : the command is not relayed        -->  S|nn|dd|ERROR: SRAT rejected; ...
+//                OFF    : no check
+//
+//            █ The Interface sets and reads the budget:
+//
+//                C|--|--|SBUD|air%,serial%[,CLAMP|REJECT|OFF]
+//                C|--|--|GBUD  -->  S|--|--|BUDGET=airUsed%,airLeft%,serialUsed%,serialLeft%,mode,clamped,rejected
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef LINKBUDGET_H
+#define LINKBUDGET_H
+
+//--- Includes --------------------------------------------
+
+#include <atomic>
+#include <Arduino.h>
+#include "Relayer.h"
+#include "TwinTable.h"
+
+//--- Defines ---------------------------------------------
+
+#define BUDGET_AIRTIME              50  // Default percent of the channel's airtime for periodic Widget Data
+#define BUDGET_SERIAL               70  // Default percent of the serial link
+#define BUDGET_ACK_TIME             50  // Microseconds of each frame's ACK and SIFS
+#define BUDGET_DEFAULT_AIRTIME     600  // Microseconds per frame before a Device is seen (about 40 bytes at 1 Mbps)
+#define BUDGET_DEFAULT_LENGTH       40  // Data String bytes per frame before a Device is seen
+#define BUDGET_RECORD_OVERHEAD      22  // '|', timestamp and CR LF added to each Data String for the Interface
+#define BUDGET_USB_BYTES       1000000  // Bytes per second of native USB, whatever the baud rate
+
+//--- Types -----------------------------------------------
+
+enum BudgetMode
+{
+  BUDGET_CLAMP,
+  BUDGET_REJECT,
+  BUDGET_OFF
+};
+
+struct BudgetLoad
+{
+  float  airtime;  // Fraction of the channel's airtime
+  float  serial;   // Fraction of the serial link
+};
+
+
+//=========================================================
+//  class LinkBudget
+//=========================================================
+
+class LinkBudget
+{
+  protected:
+    TwinTable          *twins;
+    int                 airLimit    = BUDGET_AIRTIME;
+    int                 serialLimit = BUDGET_SERIAL;
+    BudgetMode          mode        = BUDGET_CLAMP;
+    std::atomic<uint32_t>  serialBytes;  // Bytes per second of the serial link (set by the serial task on SBAU)
+
+    void  addDevice (BudgetLoad *load, DeviceTwin *device, float framesPerSecond);
+
+  public:
+    LinkBudget (TwinTable *deviceTwins);
+
+    void           SetLimits     (int airPercent, int serialPercent, BudgetMode newMode);
+    void           SetSerialRate (uint32_t baudRate);  // UART baud rate (ignored for native USB)
+    void           GetLoad       (BudgetLoad *load, int skipNode=-1, int skipDevice=-1);
+    unsigned long  MaxRate       (int nodeIndex, int deviceIndex);  // Most calls per hour Device dd can have
+
+    int         GetAirLimit    ();
+    int         GetSerialLimit ();
+    BudgetMode  GetMode        ();
+
+    static const char  *GetModeName (BudgetMode budgetMode);
+
+    //--- Counters ---
+    uint32_t  numClamped  = 0;
+    uint32_t  numRejected = 0;
+};
+
+#endif
@@ -0,0 +1,202 @@
+//=========================================================
+//
+//     FILE : Mailbox.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Mailbox class:
+//            Holds Command Strings for sleepy Nodes until they listen.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Mailbox.h"
+
+//--- Constructor -----------------------------------------
+
+Mailbox::Mailbox ()
+{
+  memset (slots, 0, sizeof(slots));
+}
+
+//--- SetSleepy -------------------------------------------
+
+void Mailbox::SetSleepy (int nodeIndex, int ms)
+{
+  if (nodeIndex < 0 || nodeIndex >= MAX_NODES)
+    return;
+
+  if (ms < 0)     ms = 0;
+  if (ms > 65535) ms = 65535;
+
+  listenTime[nodeIndex] = (uint16_t) ms;
+}
+
+//--- IsSleepy --------------------------------------------
+
+bool Mailbox::IsSleepy (int nodeIndex)
+{
+  return (nodeIndex >= 0 && nodeIndex < MAX_NODES && listenTime[nodeIndex] > 0);
+}
+
+//--- GetListen -------------------------------------------
+
+int Mailbox::GetListen (int nodeIndex)
+{
+  return (nodeIndex >= 0 && nodeIndex < MAX_NODES) ? listenTime[nodeIndex] : 0;
+}
+
+//--- SetLimits -------------------------------------------
+
+void Mailbox::SetLimits (int newLimit, long expiryMs)
+{
+  if (newLimit < 1)                  newLimit = 1;
+  if (newLimit > MAILBOX_SLOTS)      newLimit = MAILBOX_SLOTS;
+  if (expiryMs < 1000)               expiryMs = 1000;
+  if (expiryMs > MAILBOX_MAX_EXPIRY) expiryMs = MAILBOX_MAX_EXPIRY;
+
+  limit  = newLimit;
+  expiry = expiryMs * 1000LL;
+}
+
+//--- Put -------------------------------------------------
+
+MailResult Mailbox::Put (int nodeIndex, const char *text, int length, bool latest, int64_t now, Mail *dropped)
+{
+  // <dropped> gets a copy of a Command String that had to go (MAIL_DROPPED)
+  if (length > MAX_ESPNOW_LENGTH)
+    length = MAX_ESPNOW_LENGTH;
+
+  Mail  *mail   = NULL;
+  int    count  = 0;
+
+  for (int i=0; i<MAILBOX_SLOTS; i++)
+  {
+    if (!slots[i].used || slots[i].nodeIndex != nodeIndex)
+      continue;
+
+    ++count;
+
+    // Latest wins: same nodeID, deviceID and command
+    if (latest && slots[i].latest && length >= MIN_COMMAND_LENGTH && slots[i].length >= MIN_COMMAND_LENGTH
+     && strncmp (slots[i].text, text, MIN_COMMAND_LENGTH) == 0)
+      mail = &slots[i];
+  }
+
+  MailResult result = MAIL_QUEUED;
+
+  if (mail != NULL)
+    result = MAIL_REPLACED;
+  else if (count >= limit)
+  {
+    // Make room by dropping this Node's oldest Command String
+    mail = oldest (nodeIndex);
+    *dropped = *mail;
+    ++numDropped;
+    result = MAIL_DROPPED;
+  }
+  else
+  {
+    for (int i=0; i<MAILBOX_SLOTS && mail == NULL; i++)
+      if (!slots[i].used)
+        mail = &slots[i];
+
+    if (mail == NULL)
+    {
+      ++numDropped;
+      return MAIL_NO_SLOT;
+    }
+  }
+
+  // A replaced Command String keeps its place in line
+  if (result != MAIL_REPLACED)
+    mail->order = nextOrder++;
+
+  mail->used      = true;
+  mail->latest    = latest;
+  mail->nodeIndex = (int8_t) nodeIndex;
+  mail->time      = now;
+  mail->length    = length;
+  memcpy (mail->text, text, length);
+  mail->text[length] = 0;
+
+  return result;
+}
+
+//--- Next ------------------------------------------------
+
+Mail *Mailbox::Next (int nodeIndex)
+{
+  return oldest (nodeIndex);
+}
+
+//--- Delivered -------------------------------------------
+
+void Mailbox::Delivered (Mail *mail)
+{
+  ++numDelivered;
+  mail->used = false;
+}
+
+//--- Expired ---------------------------------------------
+
+Mail *Mailbox::Expired (int64_t now)
+{
+  for (int i=0; i<MAILBOX_SLOTS; i++)
+  {
+    if (slots[i].used && now - slots[i].time > expiry)
+    {
+      ++numExpired;
+      return &slots[i];
+    }
+  }
+
+  return NULL;
+}
+
+//--- Remove ----------------------------------------------
+
+void Mailbox::Remove (Mail *mail)
+{
+  mail->used = false;
+}
+
+//--- GetCount --------------------------------------------
+
+int Mailbox::GetCount (int nodeIndex)
+{
+  int count = 0;
+  for (int i=0; i<MAILBOX_SLOTS; i++)
+    if (slots[i].used && (nodeIndex < 0 || slots[i].nodeIndex == nodeIndex))
+      ++count;
+
+  return count;
+}
+
+//--- Counters --------------------------------------------
+
+int      Mailbox::GetLimit     () { return limit;                  }
+long     Mailbox::GetExpiry    () { return (long)(expiry / 1000LL); }
+uint32_t Mailbox::GetDelivered () { return numDelivered;           }
+uint32_t Mailbox::GetExpired   () { return numExpired;             }
+uint32_t Mailbox::GetDropped   () { return numDropped;             }
+
+//--- oldest ----------------------------------------------
+
+Mail *Mailbox::oldest (int nodeIndex)
+{
+  Mail *first = NULL;
+
+  for (int i=0; i<MAILBOX_SLOTS; i++)
+    if (slots[i].used && slots[i].nodeIndex == nodeIndex)
+      if (first == NULL || (int32_t)(slots[i].order - first->order) < 0)
+        first = &slots[i];
+
+  return first;
+}
@@ -0,0 +1,120 @@
+//=========================================================
+//
+//     FILE : Mailbox.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Mailbox class:
+//            Holds Command Strings for sleepy Nodes until they listen.
+//
+//            █ A battery powered Node can sleep with its radio dozing between transmissions
+//              (see Node::SetSleepy).  It tells the Relayer how long it listens after each
+//              frame it sends:
+//
+//                S|nn|--|SLEEPY=ms   (0 = always listening again)
+//
+//            █ Command Strings for a sleepy Node, from the Interface or from other Nodes, wait
+//              here and are sent as soon as the next frame from the Node comes in.
+//              Each one is answered with S|nn|dd|MAILBOX=count (Command Strings waiting for Node nn).
+//
+//            █ A Node keeps at most <limit> Command Strings.  When it has more, the oldest one is dropped.
+//              A latest-wins Command String (see SendQueue.h) replaces the one waiting with the same
+//              nodeID, deviceID and command.  A Command String that waits longer than <expiry> is
+//              dropped too.  Both are reported as errors:
+//
+//                S|nn|dd|ERROR: Mailbox full; dropped C|nn|dd|...
+//                S|nn|dd|ERROR: Command expired in mailbox: C|nn|dd|...
+//
+//            █ The Interface sets and reads the mailboxes:
+//
+//                C|--|--|SMBX|limit,expiryMs  -->  S|--|--|MAILBOX=limit,expiryMs,waiting,delivered,expired,dropped
+//                C|--|--|GMBX                 -->  S|nn|--|SLEEPY=ms,waiting  for each sleepy Node, then the line above
+//
+//            █ Broadcasts (group commands, THRO, WFCH) and emergency stops are not held:
+//              a sleeping Node only hears the ones that fall in one of its wake windows.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define MAILBOX_SLOTS            32  // Command Strings held for all sleepy Nodes
+#define MAILBOX_LIMIT             8  // Default Command Strings held for one Node
+#define MAILBOX_EXPIRY        60000  // Default millis a Command String is held
+#define MAILBOX_MAX_EXPIRY  3600000
+
+//--- Types -----------------------------------------------
+
+enum MailResult
+{
+  MAIL_QUEUED,
+  MAIL_REPLACED,  // Took the place of an older latest-wins Command String
+  MAIL_DROPPED,   // Queued, and the Node's oldest Command String was dropped to make room
+  MAIL_NO_SLOT    // Not queued; all slots are used
+};
+
+struct Mail
+{
+  bool     used;
+  bool     latest;                        // Latest-wins Command String
+  int8_t   nodeIndex;
+  uint32_t order;                         // Oldest first
+  int64_t  time;                          // When it was queued (microseconds)
+  int      length;
+  char     text[MAX_ESPNOW_LENGTH+1];     // C|nn|dd|cccc[|params]
+};
+
+
+//=========================================================
+//  class Mailbox
+//=========================================================
+
+class Mailbox
+{
+  protected:
+    Mail      slots[MAILBOX_SLOTS];
+    uint16_t  listenTime[MAX_NODES] = {};  // Millis a sleepy Node listens after each frame, 0 = always listening
+    int       limit      = MAILBOX_LIMIT;
+    int64_t   expiry     = MAILBOX_EXPIRY * 1000LL;
+    uint32_t  nextOrder  = 0;
+
+    //--- Counters ---
+    uint32_t  numDelivered = 0;
+    uint32_t  numExpired   = 0;
+    uint32_t  numDropped   = 0;  // Over the limit or no slot
+
+    Mail  *oldest (int nodeIndex);
+
+  public:
+    Mailbox ();
+
+    void        SetSleepy  (int nodeIndex, int ms);
+    bool        IsSleepy   (int nodeIndex);
+    int         GetListen  (int nodeIndex);
+    void        SetLimits  (int newLimit, long expiryMs);
+    MailResult  Put        (int nodeIndex, const char *text, int length, bool latest, int64_t now, Mail *dropped);
+    Mail       *Next       (int nodeIndex);    // Oldest Command String for Node nn, NULL if none
+    void        Delivered  (Mail *mail);       // Sent; free its slot
+    Mail       *Expired    (int64_t now);      // Next Command String held too long, NULL if none (free it with Remove)
+    void        Remove     (Mail *mail);
+    int         GetCount   (int nodeIndex=-1); // Command Strings waiting for Node nn (-1 = all)
+
+    int       GetLimit     ();
+    long      GetExpiry    ();  // Millis
+    uint32_t  GetDelivered ();
+    uint32_t  GetExpired   ();
+    uint32_t  GetDropped   ();
+};
+
+#endif
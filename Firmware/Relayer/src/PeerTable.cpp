@@ -0,0 +1,190 @@
+//=========================================================
+//
+//     FILE : PeerTable.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : PeerTable class:
+//            Holds the registered Nodes (ESP-NOW peers) of the Relayer.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "PeerTable.h"
+
+//--- Constructor -----------------------------------------
+
+PeerTable::PeerTable ()
+{
+  // Init all Nodes as unregistered
+  memset (peers, 0, sizeof(peers));
+  memset (hashSlots, -1, sizeof(hashSlots));
+}
+
+//--- IsRegistered ----------------------------------------
+
+bool PeerTable::IsRegistered (int nodeIndex)
+{
+  return (nodeIndex >= 0 && nodeIndex < MAX_NODES && peers[nodeIndex].registered);
+}
+
+//--- Register --------------------------------------------
+
+void PeerTable::Register (int nodeIndex, const uint8_t *mac)
+{
+  if (nodeIndex < 0 || nodeIndex >= MAX_NODES)
+    return;
+
+  // A MAC address belongs to only one Node
+  int oldIndex = FindNode (mac);
+  if (oldIndex >= 0 && oldIndex != nodeIndex)
+  {
+    peers[oldIndex].registered = false;
+    SetHwPeer (oldIndex, false);  // The MAC address stays an ESP-NOW peer for the new Node
+  }
+
+  // Start fresh statistics if this is a new or replaced Node
+  // (the caller removes a replaced Node's ESP-NOW peer first)
+  Peer *peer = &peers[nodeIndex];
+  if (!peer->registered || memcmp (peer->mac, mac, MAC_SIZE) != 0)
+  {
+    SetHwPeer (nodeIndex, false);
+    memset (peer, 0, sizeof(Peer));
+    memcpy (peer->mac, mac, MAC_SIZE);
+    peer->registered = true;
+  }
+
+  // Registrations are rare, so simply rebuild the reverse lookup
+  rebuildHash ();
+}
+
+//--- FindNode --------------------------------------------
+
+int PeerTable::FindNode (const uint8_t *mac)
+{
+  // Linear probe from the MAC's home slot
+  for (int i=0, slot=hashMAC(mac); i<PEER_HASH_SIZE; i++, slot=(slot+1) & (PEER_HASH_SIZE-1))
+  {
+    int nodeIndex = hashSlots[slot];
+    if (nodeIndex < 0)
+      return -1;  // Empty slot, not found
+
+    if (memcmp (peers[nodeIndex].mac, mac, MAC_SIZE) == 0)
+      return nodeIndex;
+  }
+
+  return -1;
+}
+
+//--- GetMAC ----------------------------------------------
+
+uint8_t *PeerTable::GetMAC (int nodeIndex)
+{
+  return peers[nodeIndex].mac;
+}
+
+//--- GetPeer ---------------------------------------------
+
+Peer *PeerTable::GetPeer (int nodeIndex)
+{
+  return &peers[nodeIndex];
+}
+
+//--- GetFramesPerSecond ----------------------------------
+
+float PeerTable::GetFramesPerSecond (int nodeIndex, int64_t now)
+{
+  // A Node that has gone quiet for more than a full window has no rate
+  Peer *peer = &peers[nodeIndex];
+  if (now - peer->windowStart > 2 * PEER_FPS_WINDOW)
+    return 0.0;
+
+  return peer->framesPerSecond;
+}
+
+//--- RecordReceive ---------------------------------------
+
+void PeerTable::RecordReceive (int nodeIndex, int8_t rssi, int8_t noiseFloor, int length, int64_t timestamp)
+{
+  Peer *peer = &peers[nodeIndex];
+
+  peer->lastSeen   = timestamp;
+  peer->rssi       = rssi;
+  peer->noiseFloor = noiseFloor;
+  peer->numFrames++;
+  peer->numBytes  += length;
+
+  // Frames per second over fixed windows
+  peer->windowFrames++;
+  int64_t elapsed = timestamp - peer->windowStart;
+  if (elapsed >= PEER_FPS_WINDOW)
+  {
+    peer->framesPerSecond = (peer->windowStart == 0) ? 0.0 : (float)(peer->windowFrames * 1000000.0 / elapsed);
+    peer->windowFrames    = 0;
+    peer->windowStart     = timestamp;
+  }
+}
+
+//--- RecordSendFailure -----------------------------------
+
+void PeerTable::RecordSendFailure (int nodeIndex)
+{
+  if (nodeIndex >= 0 && nodeIndex < MAX_NODES)
+    peers[nodeIndex].numSendFailures++;
+}
+
+//--- GetNumHwPeers ---------------------------------------
+
+int PeerTable::GetNumHwPeers ()
+{
+  return numHwPeers;
+}
+
+//--- SetHwPeer -------------------------------------------
+
+void PeerTable::SetHwPeer (int nodeIndex, bool isPeer)
+{
+  Peer *peer = &peers[nodeIndex];
+  if (peer->hwPeer == isPeer)
+    return;
+
+  peer->hwPeer = isPeer;
+  numHwPeers  += isPeer ? 1 : -1;
+}
+
+//--- hashMAC ---------------------------------------------
+
+int PeerTable::hashMAC (const uint8_t *mac)
+{
+  // FNV-1a over the 6 MAC bytes
+  uint32_t hash = 2166136261UL;
+  for (int i=0; i<MAC_SIZE; i++)
+    hash = (hash ^ mac[i]) * 16777619UL;
+
+  return (int)(hash & (PEER_HASH_SIZE - 1));
+}
+
+//--- rebuildHash -----------------------------------------
+
+void PeerTable::rebuildHash ()
+{
+  memset (hashSlots, -1, sizeof(hashSlots));
+
+  for (int nodeIndex=0; nodeIndex<MAX_NODES; nodeIndex++)
+  {
+    if (!peers[nodeIndex].registered)
+      continue;
+
+    int slot = hashMAC (peers[nodeIndex].mac);
+    while (hashSlots[slot] >= 0)
+      slot = (slot + 1) & (PEER_HASH_SIZE - 1);
+
+    hashSlots[slot] = nodeIndex;
+  }
+}
@@ -0,0 +1,96 @@
+//=========================================================
+//
+//     FILE : PeerTable.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : PeerTable class:
+//            Holds the registered Nodes (ESP-NOW peers) of the Relayer.
+//
+//            █ Each Node index maps to its MAC address, and a small hash table
+//              maps each MAC address back to its Node index in O(1).
+//
+//            █ Passive link statistics are kept for every Node from the frames
+//              it sends and the sends that fail.  No extra airtime is used.
+//
+//            █ There can be more Nodes (MAX_NODES) than the radio has ESP-NOW peers (MAX_HW_PEERS).
+//              The table keeps which Nodes are currently ESP-NOW peers and when each Node
+//              was last addressed, so the Relayer can swap out the least recently used peer.
+//
+//            █ The Interface reads the statistics with the GLNK command.
+//              One line is returned for each registered Node:
+//
+//                S|nn|--|LINK=mac,rssi,noiseFloor,framesPerSec,frames,bytes,sendFailures,msSinceLastSeen
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef PEERTABLE_H
+#define PEERTABLE_H
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define PEER_HASH_SIZE        256  // Slots in the MAC hash table (power of 2, at least twice MAX_NODES)
+#define PEER_FPS_WINDOW   1000000L  // Microseconds per frames-per-second measurement
+
+//--- Types -----------------------------------------------
+
+struct Peer
+{
+  bool      registered;
+  uint8_t   mac[MAC_SIZE];
+  int64_t   lastSeen;         // Capture time of the last frame from this Node (microseconds)
+  int8_t    rssi;             // Signal strength of the last frame (dBm)
+  int8_t    noiseFloor;       // Noise floor of the last frame (dBm)
+  uint32_t  numFrames;        // Frames received from this Node
+  uint32_t  numBytes;         // Bytes received from this Node
+  uint32_t  numSendFailures;  // Sends to this Node that failed
+  uint32_t  numUnconfirmed;   // Messages broadcast to this Node for lack of an ESP-NOW peer
+  uint32_t  windowFrames;     // Frames in the current frames-per-second window
+  int64_t   windowStart;
+  float     framesPerSecond;  // Receive rate of the last full window
+  bool      hwPeer;           // Currently in the radio's ESP-NOW peer table
+  int64_t   lastUsed;         // Time this Node was last sent to (microseconds)
+};
+
+
+//=========================================================
+//  class PeerTable
+//=========================================================
+
+class PeerTable
+{
+  protected:
+    Peer    peers[MAX_NODES];
+    int8_t  hashSlots[PEER_HASH_SIZE];  // Node index for each slot, -1 = empty
+    int     numHwPeers = 0;             // Nodes that are ESP-NOW peers
+
+    int   hashMAC     (const uint8_t *mac);
+    void  rebuildHash ();
+
+  public:
+    PeerTable ();
+
+    bool      IsRegistered       (int nodeIndex);
+    void      Register           (int nodeIndex, const uint8_t *mac);
+    int       FindNode           (const uint8_t *mac);  // Node index of a MAC address, or -1 if unknown
+    uint8_t  *GetMAC             (int nodeIndex);
+    Peer     *GetPeer            (int nodeIndex);
+    float     GetFramesPerSecond (int nodeIndex, int64_t now);
+
+    void      RecordReceive      (int nodeIndex, int8_t rssi, int8_t noiseFloor, int length, int64_t timestamp);
+    void      RecordSendFailure  (int nodeIndex);
+
+    int       GetNumHwPeers      ();
+    void      SetHwPeer          (int nodeIndex, bool isPeer);
+};
+
+#endif
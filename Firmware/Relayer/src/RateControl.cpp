@@ -0,0 +1,294 @@
+//=========================================================
+//
+//     FILE : RateControl.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : RateControl class:
+//            Picks the ESP-NOW PHY rate of each unicast peer.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+#include "RateControl.h"
+
+//--- Types -----------------------------------------------
+
+struct RateInfo
+{
+  const char       *name;
+  wifi_phy_mode_t   phyMode;
+  wifi_phy_rate_t   phyRate;
+  int8_t            sensitivity;  // Weakest signal the rate is received at, roughly (dBm)
+};
+
+//--- Globals ---------------------------------------------
+
+const RateInfo  Rates[NUM_RATES] =
+{
+  { "LR250", WIFI_PHY_MODE_LR,   WIFI_PHY_RATE_LORA_250K, -103 },
+  { "LR500", WIFI_PHY_MODE_LR,   WIFI_PHY_RATE_LORA_500K, -100 },
+  { "1M",    WIFI_PHY_MODE_11B,  WIFI_PHY_RATE_1M_L,       -98 },
+  { "2M",    WIFI_PHY_MODE_11B,  WIFI_PHY_RATE_2M_L,       -95 },
+  { "5.5M",  WIFI_PHY_MODE_11B,  WIFI_PHY_RATE_5M_L,       -93 },
+  { "6M",    WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_6M,         -92 },
+  { "11M",   WIFI_PHY_MODE_11B,  WIFI_PHY_RATE_11M_L,      -89 },
+  { "12M",   WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_12M,        -88 },
+  { "24M",   WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_24M,        -84 },
+  { "36M",   WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_36M,        -80 },
+  { "48M",   WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_48M,        -76 },
+  { "54M",   WIFI_PHY_MODE_11G,  WIFI_PHY_RATE_54M,        -74 },
+  { "MCS7",  WIFI_PHY_MODE_HT20, WIFI_PHY_RATE_MCS7_LGI,   -72 }
+};
+
+//--- Constructor -----------------------------------------
+
+RateControl::RateControl ()
+{
+  memset (peers, 0, sizeof(peers));
+}
+
+//--- Begin -----------------------------------------------
+
+bool RateControl::Begin ()
+{
+  uint8_t protocols = WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N;
+  if (RATE_LONG_RANGE)
+    protocols |= WIFI_PROTOCOL_LR;
+
+  return (esp_wifi_set_protocol (WIFI_IF_STA, protocols) == ESP_OK);
+}
+
+//--- Apply -----------------------------------------------
+
+void RateControl::Apply (const uint8_t *mac)
+{
+  PeerRate *rate = find (mac, true);
+  if (rate != NULL)
+    setLevel (rate, rate->level);
+}
+
+//--- RecordStatus ----------------------------------------
+
+void RateControl::RecordStatus (const uint8_t *mac, bool delivered)
+{
+  PeerRate *rate = find (mac, false);
+  if (rate == NULL)
+    return;
+
+  rate->lastUsed = ++useCount;
+  ++rate->windowSent;
+
+  if (delivered)
+    rate->failuresInRow = 0;
+  else
+  {
+    ++rate->windowFailed;
+    ++rate->failuresInRow;
+  }
+
+  if (!rate->automatic)
+  {
+    if (rate->windowSent >= RATE_WINDOW)
+      rate->windowSent = rate->windowFailed = 0;
+
+    return;
+  }
+
+  // Fall back quickly, so retries go out at a more robust rate
+  if (rate->failuresInRow >= RATE_DOWN_FAILURES && rate->level > MinLevel ())
+  {
+    ++rate->numDown;
+    setLevel (rate, rate->level - 1);
+    return;
+  }
+
+  if (rate->windowSent < RATE_WINDOW)
+    return;
+
+  int loss = 100 * rate->windowFailed / rate->windowSent;
+
+  if (loss > RATE_DOWN_LOSS && rate->level > MinLevel ())
+  {
+    ++rate->numDown;
+    setLevel (rate, rate->level - 1);
+  }
+  else if (loss < RATE_UP_LOSS && rate->level < maxLevel (rate))
+  {
+    ++rate->numUp;
+    setLevel (rate, rate->level + 1);
+  }
+  else
+    rate->windowSent = rate->windowFailed = 0;
+}
+
+//--- RecordRSSI ------------------------------------------
+
+void RateControl::RecordRSSI (const uint8_t *mac, int8_t rssi)
+{
+  PeerRate *rate = find (mac, false);
+  if (rate == NULL || rssi == 0)
+    return;
+
+  bool firstHeard = (rate->rssi == 0);
+  rate->rssi = rssi;
+
+  if (!rate->automatic)
+    return;
+
+  // Start just below the fastest rate the signal allows; failures and successes take it from there
+  int fastest = maxLevel (rate);
+  if (firstHeard && fastest - 1 > rate->level)
+    setLevel (rate, fastest - 1);
+  else if (rate->level > fastest)
+  {
+    ++rate->numDown;
+    setLevel (rate, fastest);
+  }
+}
+
+//--- SetFixed --------------------------------------------
+
+void RateControl::SetFixed (const uint8_t *mac, int level)
+{
+  if (level >= NUM_RATES || (level >= 0 && level < MinLevel ()))
+    return;
+
+  if (mac == NULL)
+  {
+    defaultAutomatic = (level < 0);
+    defaultLevel     = (level < 0) ? RATE_1M : level;
+
+    for (int i=0; i<RATE_PEERS; i++)
+      if (peers[i].inUse)
+        SetFixed (peers[i].mac, level);
+
+    return;
+  }
+
+  PeerRate *rate = find (mac, true);
+  if (rate == NULL)
+    return;
+
+  rate->automatic = (level < 0);
+  if (level >= 0)
+    setLevel (rate, level);
+}
+
+//--- GetRate ---------------------------------------------
+
+PeerRate *RateControl::GetRate (const uint8_t *mac)
+{
+  return find (mac, false);
+}
+
+//--- GetName ---------------------------------------------
+
+const char *RateControl::GetName (int level)
+{
+  return (level >= 0 && level < NUM_RATES) ? Rates[level].name : "?";
+}
+
+//--- FindLevel -------------------------------------------
+
+int RateControl::FindLevel (const char *name)
+{
+  for (int level=MinLevel (); level<NUM_RATES; level++)
+    if (strcmp (Rates[level].name, name) == 0)
+      return level;
+
+  return -1;
+}
+
+//--- MinLevel --------------------------------------------
+
+int RateControl::MinLevel ()
+{
+  return RATE_LONG_RANGE ? RATE_LR_250K : RATE_1M;
+}
+
+//--- find ------------------------------------------------
+
+PeerRate *RateControl::find (const uint8_t *mac, bool add)
+{
+  PeerRate *slot = NULL;
+
+  for (int i=0; i<RATE_PEERS; i++)
+  {
+    if (!peers[i].inUse)
+    {
+      if (slot == NULL) slot = &peers[i];
+    }
+    else if (memcmp (peers[i].mac, mac, MAC_SIZE) == 0)
+      return &peers[i];
+  }
+
+  if (!add)
+    return NULL;
+
+  // Reuse the entry of a peer that is gone, or else the least recently used one
+  for (int i=0; i<RATE_PEERS && slot == NULL; i++)
+    if (!esp_now_is_peer_exist (peers[i].mac))
+      slot = &peers[i];
+
+  if (slot == NULL)
+  {
+    slot = &peers[0];
+    for (int i=1; i<RATE_PEERS; i++)
+      if ((int32_t)(peers[i].lastUsed - slot->lastUsed) < 0)
+        slot = &peers[i];
+  }
+
+  memset (slot, 0, sizeof(PeerRate));
+  memcpy (slot->mac, mac, MAC_SIZE);
+  slot->inUse     = true;
+  slot->automatic = defaultAutomatic;
+  slot->level     = defaultLevel;
+  slot->lastUsed  = ++useCount;
+
+  return slot;
+}
+
+//--- maxLevel --------------------------------------------
+
+int RateControl::maxLevel (PeerRate *rate)
+{
+  // Fastest rate the peer's signal allows (all of them until it is heard)
+  if (rate->rssi == 0)
+    return NUM_RATES - 1;
+
+  int level = NUM_RATES - 1;
+  while (level > MinLevel () && rate->rssi < Rates[level].sensitivity + RATE_RSSI_MARGIN)
+    --level;
+
+  return level;
+}
+
+//--- setLevel --------------------------------------------
+
+void RateControl::setLevel (PeerRate *rate, int level)
+{
+  rate->level         = level;
+  rate->windowSent    = 0;
+  rate->windowFailed  = 0;
+  rate->failuresInRow = 0;
+
+  // The radio only keeps a rate for an ESP-NOW peer; Apply() sets it again when the peer is added
+  if (!esp_now_is_peer_exist (rate->mac))
+    return;
+
+  esp_now_rate_config_t  rateConfig = {};
+  rateConfig.phymode = Rates[level].phyMode;
+  rateConfig.rate    = Rates[level].phyRate;
+  rateConfig.ersu    = false;
+  rateConfig.dcm     = false;
+
+  esp_now_set_peer_rate_config (rate->mac, &rateConfig);
+}
@@ -0,0 +1,131 @@
+//=========================================================
+//
+//     FILE : RateControl.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : RateControl class:
+//            Picks the ESP-NOW PHY rate of each unicast peer.
+//
+//            █ The rates form a ladder from the most robust to the fastest:
+//
+//                LR250, LR500                 802.11 Long Range (RATE_LONG_RANGE)
+//                1M, 2M, 5.5M                 802.11b
+//                6M, 11M, 12M, 24M, 36M,
+//                48M, 54M                     802.11b/g
+//                MCS7                         802.11n HT20 (65 Mbps)
+//
+//              A close peer gets a fast rate, so its frames take little airtime.  A far
+//              peer drops to a slower, more robust rate.
+//
+//            █ In automatic mode the rate follows the link:
+//              ∙ RATE_DOWN_FAILURES failed sends in a row step down right away
+//              ∙ every RATE_WINDOW sends, more than RATE_DOWN_LOSS percent failed steps down,
+//                and less than RATE_UP_LOSS percent failed steps up
+//              ∙ the peer's RSSI caps the rate at the fastest one it can be heard at
+//                (sensitivity plus RATE_RSSI_MARGIN), and picks the first rate when it is heard
+//
+//            █ The Interface can fix the rate of a Node, or of all Nodes, with the Relayer's SPHY
+//              command and list the rates with GPHY.  Nodes always pick their rates automatically.
+//
+//            █ The SendQueue reports the delivery status of every unicast send (see SetRateControl).
+//              Broadcasts always go at the default rate so every Node can hear them.
+//
+//            █ The Long Range rates can only be heard by peers with the LR protocol enabled.
+//              Begin() enables it, so every Node and the Relayer must have the same RATE_LONG_RANGE.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef RATECONTROL_H
+#define RATECONTROL_H
+
+//--- Includes --------------------------------------------
+
+#include <esp_now.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define RATE_PEERS            20  // Peers with a rate (the radio holds 20 ESP-NOW peers)
+#define RATE_WINDOW           20  // Sends per adaptation step
+#define RATE_UP_LOSS          10  // Percent of failed sends in a window below which the rate steps up
+#define RATE_DOWN_LOSS        30  // Percent of failed sends in a window above which the rate steps down
+#define RATE_DOWN_FAILURES     2  // Failed sends in a row that step down right away
+#define RATE_RSSI_MARGIN       6  // dB above a rate's sensitivity needed to use it
+
+#ifndef RATE_LONG_RANGE
+#define RATE_LONG_RANGE        1  // Use the 802.11 LR rates for far peers (must match on every peer)
+#endif
+
+//--- Types -----------------------------------------------
+
+enum RateLevel
+{
+  RATE_LR_250K,
+  RATE_LR_500K,
+  RATE_1M,
+  RATE_2M,
+  RATE_5M5,
+  RATE_6M,
+  RATE_11M,
+  RATE_12M,
+  RATE_24M,
+  RATE_36M,
+  RATE_48M,
+  RATE_54M,
+  RATE_MCS7,
+  NUM_RATES
+};
+
+struct PeerRate
+{
+  bool      inUse;
+  uint8_t   mac[MAC_SIZE];
+  bool      automatic;       // Follows the link, or fixed with SetFixed()
+  int8_t    level;           // RateLevel
+  int8_t    rssi;            // Signal strength of the last frame from this peer (dBm), 0 = not heard yet
+  uint16_t  windowSent;      // Sends in the current window
+  uint16_t  windowFailed;
+  uint8_t   failuresInRow;
+  uint32_t  lastUsed;        // Use count of the last send, to reuse the least recently used entry
+  uint32_t  numUp;           // Steps up and down
+  uint32_t  numDown;
+};
+
+
+//=========================================================
+//  class RateControl
+//=========================================================
+
+class RateControl
+{
+  protected:
+    PeerRate  peers[RATE_PEERS];
+    bool      defaultAutomatic = true;
+    int8_t    defaultLevel     = RATE_1M;  // The ESP-NOW default rate
+    uint32_t  useCount         = 0;
+
+    PeerRate  *find      (const uint8_t *mac, bool add);
+    int        maxLevel  (PeerRate *rate);
+    void       setLevel  (PeerRate *rate, int level);
+
+  public:
+    RateControl ();
+
+    bool       Begin        ();  // Enable the LR protocol; call after WiFi.mode()
+    void       Apply        (const uint8_t *mac);  // Set a new peer's rate; call after esp_now_add_peer()
+    void       RecordStatus (const uint8_t *mac, bool delivered);
+    void       RecordRSSI   (const uint8_t *mac, int8_t rssi);
+    void       SetFixed     (const uint8_t *mac, int level);  // level -1 = automatic; mac NULL = all peers and new ones
+    PeerRate  *GetRate      (const uint8_t *mac);             // NULL if the peer has no rate yet
+
+    static const char  *GetName   (int level);
+    static int          FindLevel (const char *name);  // -1 if unknown
+    static int          MinLevel  ();
+};
+
+#endif
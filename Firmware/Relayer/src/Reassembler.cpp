@@ -0,0 +1,205 @@
+//=========================================================
+//
+//     FILE : Reassembler.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Reassembler class:
+//            Puts long Data Strings back together from their ESP-NOW fragments.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Reassembler.h"
+
+//--- Constructor -----------------------------------------
+
+Reassembler::Reassembler ()
+{
+  memset (slots, 0, sizeof(slots));
+}
+
+//--- Add -------------------------------------------------
+
+FragmentResult Reassembler::Add (int nodeIndex, const char *fragment, int length, int64_t timestamp, Reassembly **message)
+{
+  // F|nn|dd|t,mid,index,count|chunk
+  char          type;
+  unsigned int  messageID, index, count;
+  int           headerLength = 0;
+
+  *message = NULL;
+  length   = strnlen (fragment, length);  // Don't count the NULL terminator
+
+  if (length <= VC_OFFSET
+   || sscanf (fragment + VC_OFFSET, "%c,%u,%u,%u%n", &type, &messageID, &index, &count, &headerLength) != 4
+   || fragment[VC_OFFSET + headerLength] != '|'
+   || (type != 'W' && type != 'S') || messageID > 255 || count < 1 || count > MAX_FRAGMENTS || index >= count)
+  {
+    ++numInvalid;
+    return FRAGMENT_INVALID;
+  }
+
+  // Every chunk but the last one is full
+  const char *chunk       = fragment + VC_OFFSET + headerLength + 1;
+  int         chunkLength = length - (int)(chunk - fragment);
+
+  if (chunkLength < 1 || chunkLength > FRAGMENT_CHUNK || (index < count - 1 && chunkLength != FRAGMENT_CHUNK))
+  {
+    ++numInvalid;
+    return FRAGMENT_INVALID;
+  }
+
+  ++numFragments;
+
+  // A finished Data String only answers repeats
+  Reassembly *slot = find (nodeIndex, messageID);
+  if (slot != NULL && slot->state == REASSEMBLY_DONE)
+  {
+    slot->lastTime = timestamp;
+    *message = slot;
+    return FRAGMENT_REPEAT;
+  }
+
+  // A different count means the Node has reused the message ID
+  if (slot != NULL && slot->count != count)
+    slot->state = REASSEMBLY_FREE;
+
+  if (slot == NULL || slot->state == REASSEMBLY_FREE)
+  {
+    if (slot == NULL && (slot = allocate ()) == NULL)
+    {
+      ++numNoSlot;
+      return FRAGMENT_NO_SLOT;
+    }
+
+    slot->state     = REASSEMBLY_RECEIVING;
+    slot->nodeIndex = (int8_t) nodeIndex;
+    slot->messageID = (uint8_t) messageID;
+    slot->count     = (uint8_t) count;
+    slot->received  = 0;
+    slot->firstTime = timestamp;
+    slot->length    = 0;
+
+    // d|nn|dd|
+    memcpy (slot->text, fragment, VC_OFFSET);
+    slot->text[0] = type;
+  }
+
+  *message = slot;
+  slot->lastTime = timestamp;
+
+  if ((slot->received & (1 << index)) == 0)
+  {
+    memcpy (slot->text + VC_OFFSET + index*FRAGMENT_CHUNK, chunk, chunkLength);
+    slot->received |= (uint16_t)(1 << index);
+
+    // The last chunk sets the length
+    if (index == count - 1)
+      slot->length = VC_OFFSET + index*FRAGMENT_CHUNK + chunkLength;
+  }
+  else
+    return FRAGMENT_MISSING;  // A repeat, so the Node is missing our FACK
+
+  if (slot->received == (uint16_t)((1 << count) - 1))
+  {
+    slot->state = REASSEMBLY_DONE;
+    slot->text[slot->length] = 0;
+    ++numMessages;
+    return FRAGMENT_COMPLETE;
+  }
+
+  return (index == count - 1) ? FRAGMENT_MISSING : FRAGMENT_ADDED;
+}
+
+//--- Expire ----------------------------------------------
+
+void Reassembler::Expire (int64_t now)
+{
+  for (int i=0; i<REASSEMBLY_SLOTS; i++)
+  {
+    Reassembly *slot = &slots[i];
+
+    if (slot->state == REASSEMBLY_RECEIVING && now - slot->lastTime > REASSEMBLY_TIMEOUT)
+    {
+      slot->state = REASSEMBLY_FREE;
+      ++numTimeouts;
+    }
+    else if (slot->state == REASSEMBLY_DONE && !slot->sending && now - slot->lastTime > REASSEMBLY_KEEP)
+      slot->state = REASSEMBLY_FREE;
+  }
+}
+
+//--- find ------------------------------------------------
+
+Reassembly *Reassembler::find (int nodeIndex, int messageID)
+{
+  for (int i=0; i<REASSEMBLY_SLOTS; i++)
+    if (slots[i].state != REASSEMBLY_FREE && slots[i].nodeIndex == nodeIndex && slots[i].messageID == messageID)
+      return &slots[i];
+
+  return NULL;
+}
+
+//--- allocate --------------------------------------------
+
+Reassembly *Reassembler::allocate ()
+{
+  // A free slot, or else the finished one that has waited longest for repeats
+  // (one the serial task is still writing can't be taken)
+  Reassembly *oldest = NULL;
+
+  for (int i=0; i<REASSEMBLY_SLOTS; i++)
+  {
+    Reassembly *slot = &slots[i];
+
+    if (slot->state == REASSEMBLY_FREE)
+      return slot;
+
+    if (slot->state == REASSEMBLY_DONE && !slot->sending && (oldest == NULL || slot->lastTime < oldest->lastTime))
+      oldest = slot;
+  }
+
+  return oldest;
+}
+
+//--- GetMessages -----------------------------------------
+
+uint32_t Reassembler::GetMessages ()
+{
+  return numMessages;
+}
+
+//--- GetFragments ----------------------------------------
+
+uint32_t Reassembler::GetFragments ()
+{
+  return numFragments;
+}
+
+//--- GetTimeouts -----------------------------------------
+
+uint32_t Reassembler::GetTimeouts ()
+{
+  return numTimeouts;
+}
+
+//--- GetNoSlot -------------------------------------------
+
+uint32_t Reassembler::GetNoSlot ()
+{
+  return numNoSlot;
+}
+
+//--- GetInvalid ------------------------------------------
+
+uint32_t Reassembler::GetInvalid ()
+{
+  return numInvalid;
+}
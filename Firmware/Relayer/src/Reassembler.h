@@ -0,0 +1,124 @@
+//=========================================================
+//
+//     FILE : Reassembler.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Reassembler class:
+//            Puts long Data Strings back together from their ESP-NOW fragments.
+//
+//            █ A Node sends a Data String with more than one frame's worth of values
+//              (see Node::SendData) as up to MAX_FRAGMENTS fragments:
+//
+//                F|nn|dd|t,mid,index,count|chunk
+//
+//                t     : 'W' or 'S', the type of the whole Data String
+//                mid   : message ID (0-255) chosen by the Node
+//                index : 0 to count-1
+//                chunk : FRAGMENT_CHUNK chars of values (the last one may be shorter)
+//
+//            █ When all fragments are in, the Data String (d|nn|dd|values) is relayed to
+//              the Interface with the capture time of its first fragment, and the Relayer
+//              acknowledges every fragment:
+//
+//                C|nn|--|FACK|mid,bitmap   (bitmap in hex, bit i = fragment i received)
+//
+//              The Relayer also sends a FACK with the fragments it has so far when the last
+//              fragment arrives with some missing, or when a fragment it already has arrives
+//              again.  The Node then sends only the missing fragments (selective retransmit).
+//
+//            █ Only REASSEMBLY_SLOTS Data Strings are put together at a time.  A slot is given up
+//              after REASSEMBLY_TIMEOUT without a new fragment.  A finished slot is kept for
+//              REASSEMBLY_KEEP to answer repeated fragments, unless the slot is needed.
+//
+//            █ GFRG returns the counters:
+//
+//                S|--|--|FRAG=messages,fragments,timeouts,noSlot,invalid
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef REASSEMBLER_H
+#define REASSEMBLER_H
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define REASSEMBLY_SLOTS          8  // Long Data Strings being put together at the same time
+#define REASSEMBLY_TIMEOUT  1000000L  // Microseconds without a fragment before a slot is given up
+#define REASSEMBLY_KEEP      500000L  // Microseconds a finished slot answers repeated fragments
+
+//--- Types -----------------------------------------------
+
+enum ReassemblyState
+{
+  REASSEMBLY_FREE,
+  REASSEMBLY_RECEIVING,
+  REASSEMBLY_DONE        // Relayed, kept to answer repeated fragments
+};
+
+enum FragmentResult
+{
+  FRAGMENT_INVALID,      // Bad header or chunk
+  FRAGMENT_NO_SLOT,      // All slots are busy
+  FRAGMENT_ADDED,        // Stored, more to come
+  FRAGMENT_MISSING,      // Last fragment, or a repeat; some are still missing
+  FRAGMENT_COMPLETE,     // All fragments are in
+  FRAGMENT_REPEAT        // For a Data String that is already complete
+};
+
+struct Reassembly
+{
+  ReassemblyState  state;
+  volatile bool    sending;                 // The serial task is still writing <text>
+  int8_t           nodeIndex;
+  uint8_t          messageID;
+  uint8_t          count;                   // Number of fragments
+  uint16_t         received;                // Bitmap of the fragments received
+  int64_t          firstTime;               // Capture time of the first fragment to arrive
+  int64_t          lastTime;                // Capture time of the last fragment to arrive
+  int              length;                  // Length of <text> once complete
+  char             text[MAX_LONG_LENGTH+1]; // d|nn|dd|values
+};
+
+
+//=========================================================
+//  class Reassembler
+//=========================================================
+
+class Reassembler
+{
+  protected:
+    Reassembly  slots[REASSEMBLY_SLOTS];
+
+    //--- Counters ---
+    uint32_t  numMessages  = 0;  // Data Strings put together
+    uint32_t  numFragments = 0;
+    uint32_t  numTimeouts  = 0;  // Data Strings given up
+    uint32_t  numNoSlot    = 0;  // Fragments dropped because all slots were busy
+    uint32_t  numInvalid   = 0;
+
+    Reassembly  *find     (int nodeIndex, int messageID);
+    Reassembly  *allocate ();
+
+  public:
+    Reassembler ();
+
+    FragmentResult  Add     (int nodeIndex, const char *fragment, int length, int64_t timestamp, Reassembly **message);
+    void            Expire  (int64_t now);  // Give up on stale slots
+
+    uint32_t  GetMessages  ();
+    uint32_t  GetFragments ();
+    uint32_t  GetTimeouts  ();
+    uint32_t  GetNoSlot    ();
+    uint32_t  GetInvalid   ();
+};
+
+#endif
@@ -16,37 +16,83 @@
 #include <WiFi.h>
 #include <esp_now.h>
 #include <esp_wifi.h>
+#include <esp_timer.h>
 #include "Relayer.h"
+#include "RxQueue.h"
+#include "Uplink.h"
+#include "PeerTable.h"
+#include "SendQueue.h"
+#include "Stats.h"
+#include "LineQueue.h"
+#include "GroupTable.h"
+#include "Aggregator.h"
+#include "RateControl.h"
+#include "Reassembler.h"
+#include "TwinTable.h"
+#include "LinkBudget.h"
+#include "Mailbox.h"
 
 //--- Globals ---------------------------------------------
 
 char                 Version[] = "2026.01.06";
 esp_err_t            ESPNOW_Result;                   // Error code from ESP-NOW functions
 esp_now_peer_info_t  PeerInfo = {};                   // Required to set new ESP-NOW peers
-uint8_t              NodeMACs[MAX_NODES][MAC_SIZE];   // Each node MAC address is 6 bytes (xx:xx:xx:xx:xx:xx)
-bool                 ProcessingESPNOWString = false;  // Used to block from reentering ESPNOW_Receiver()
+const uint8_t        BroadcastMAC[MAC_SIZE] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };  // ESP-NOW broadcast address
+uint8_t              OwnMAC[MAC_SIZE];                // This Relayer's MAC address
+PeerTable            Peers;                           // Registered Nodes with their MAC addresses and link statistics
+GroupTable           Groups;                          // Named groups of Node/Devices for broadcast commands
+Aggregator           Streams;                         // Decimation and aggregation policies for Widget Data streams
+RateControl          Rates;                           // PHY rate of each ESP-NOW peer
+Reassembler          Fragments;                       // Long Data Strings being put back together from their fragments
+TwinTable            Twins;                           // Last known info and Widget Data of every Node and Device (see SYSI, GLVA)
+LinkBudget           Budget (&Twins);                 // Airtime and serial bandwidth taken by periodic Widget Data (see SRAT, GBUD)
+Mailbox              Mailboxes;                       // Command Strings waiting for sleepy Nodes to listen
+const char          *AggModeNames[] = { "PASS", "DEC", "AVG", "MMM" };  // SAGG mode names, in AggMode order
+RxQueue              ESPNOW_Queue;                    // Incoming ESP-NOW frames waiting to be processed by the radio task
+SendQueue            Outbox;                          // Outgoing ESP-NOW messages with retries and delivery status
+Uplink               InterfaceLink;                   // Formats and writes all output to the SMAC Interface (serial task only)
+LineQueue            FromInterface;                   // Command Strings from the serial task to the radio task
+LineQueue            UrgentFromInterface;             // Emergency stops from the serial task, ahead of all other commands
+LineQueue            ToInterface;                     // Messages and Data Strings from the radio task to the serial task
+TaskHandle_t         RadioTaskHandle  = NULL;         // Woken by new ESP-NOW frames and commands
+TaskHandle_t         SerialTaskHandle = NULL;         // Woken by serial input and lines for the Interface
+Stats                Counters;                        // Runtime performance counters (see STAT command)
+volatile int         SampledChannel = 0;              // Channel the survey is listening to, 0 = none (see SURV command)
+volatile uint32_t    SurveyFrames[MAX_CHANNEL+1];     // Frames heard on each channel
+volatile uint32_t    SurveyAirtime[MAX_CHANNEL+1];    // Estimated airtime of those frames (microseconds)
 int                  NodeIndex;                       // Global for performance
-char                 DataString[MAX_ESPNOW_LENGTH];
-char                 TimestampField[MAX_TIMESTAMP_LENGTH+1] = "|";  // First char must be '|'
+char                 DataString[MAX_ESPNOW_LENGTH+1];
 
 //--- Declarations ----------------------------------------
 
-void ESPNOW_Receiver (const esp_now_recv_info_t *info, const uint8_t *espnowString, int stringLength);
+void     RadioTask         (void *relayer);
+void     SerialTask        (void *relayer);
+void     SerialReceived    ();
+void     ESPNOW_Receiver   (const esp_now_recv_info_t *info, const uint8_t *espnowString, int stringLength);
+void     ESPNOW_SendFailed (const uint8_t *mac, const uint8_t *data, int length, bool final);
+int64_t  RadioTimestamp    (const esp_now_recv_info_t *info);
+bool     IsMulticast       (const char *string);
+bool     IsEStop           (const char *line, int length);
+bool     IsLinkCommand     (const char *commandString);
+void     SurveySniffer     (void *buffer, wifi_promiscuous_pkt_type_t type);
+uint32_t FrameAirtime      (const wifi_pkt_rx_ctrl_t *rxControl);
+int      ParseID           (const char *id);
 
 //--- Constructor -----------------------------------------
 
 Relayer::Relayer ()
 {
-  // Init Serial comms
+  // Init Serial comms with large driver buffers
+  // so bursts from many Nodes don't block the loop
+  Serial.setRxBufferSize (SERIAL_RX_BUFFER);
+#if !defined(HOST_LINK_USB) || ARDUINO_USB_MODE
+  Serial.setTxBufferSize (SERIAL_TX_BUFFER);  // TinyUSB CDC has no transmit buffer setting
+#endif
   Serial.begin   (SERIAL_BAUDRATE);
   Serial.print   ("\nSMAC Relayer Version ");
   Serial.println (Version);
   Serial.println ("----------------------------------------");
 
-  // Init all Nodes as unregistered (using first byte as a flag)
-  for (NodeIndex=0; NodeIndex<MAX_NODES; NodeIndex++)
-    NodeMACs[NodeIndex][0] = 0xFF;
-
   // Init ESP-NOW comms with remote Nodes
   // Set this device as a Wi-Fi Station
   if (!WiFi.mode (WIFI_STA))
@@ -58,22 +104,14 @@ Relayer::Relayer ()
 
   // Init peer info structure for adding new peers
   Serial.print ("WiFi Channel is "); Serial.println (WiFi.channel());
+  homeChannel = WiFi.channel ();
+  esp_wifi_get_mac (WIFI_IF_STA, OwnMAC);
   PeerInfo.channel = 0;  // 0 = Auto-select channel
   PeerInfo.encrypt = false;
 
-
-
-  // // Set WiFi rate ???  5-GHz ???
-  // // Load this Node's MAC address
-  // uint8_t  macAddress[MAC_SIZE+2];
-  // for (int i=0; i<MAC_SIZE+2; i++) macAddress[i] = 0;  // Clear result first
-  // esp_efuse_mac_get_default (macAddress);  // System-programmed by Espressif, 6 bytes
-  // // --OR--
-  // macAddress = WiFi.macAddress ();
-  // esp_now_rate_config_t  rateConfig = { ... };
-  // esp_now_set_peer_rate_config (macAddress, &rateConfig);
-
-
+  // Allow the Long Range rates; the rate of each Node is set when it becomes an ESP-NOW peer
+  if (!Rates.Begin ())
+    Serial.println ("ERROR: Unable to enable the WiFi Long Range protocol.");
 
   // Init ESP-NOW protocol
   ESPNOW_Result = esp_now_init ();
@@ -93,6 +131,25 @@ Relayer::Relayer ()
     return;
   }
 
+  // Broadcast peer, used when a Node can't be made an ESP-NOW peer
+  memcpy (PeerInfo.peer_addr, BroadcastMAC, MAC_SIZE);
+  ESPNOW_Result = esp_now_add_peer (&PeerInfo);
+  if (ESPNOW_Result != ESP_OK)
+  {
+    Serial.print   ("ERROR: Unable to add broadcast peer: ");
+    Serial.println (ESPNOW_Result);
+    return;
+  }
+
+  // Register send event for delivery tracking
+  if (!Outbox.Begin ())
+  {
+    Serial.println ("ERROR: Unable to register ESP-NOW send handler.");
+    return;
+  }
+  Outbox.SetFailedHandler (ESPNOW_SendFailed);
+  Outbox.SetRateControl   (&Rates);
+
   // Good to go
   Serial.print   ("S|--|--|Relayer is running: MAC=");
   Serial.println (WiFi.macAddress ());
@@ -107,302 +164,2485 @@ bool Relayer::IsOkay ()
   return startupStatus;
 }
 
-//--- Run -------------------------------------------------
+//--- Start -----------------------------------------------
+
+bool Relayer::Start ()
+{
+  // The Relayer runs as a two stage pipeline:
+  //
+  //   Radio task  (RADIO_TASK_CORE, the protocol core with WiFi)
+  //     ESP-NOW ingress and egress, peers, send queue, discovery and all Relayer commands
+  //
+  //   Serial task (SERIAL_TASK_CORE, the application core)
+  //     Serial ingress (reading and splitting Command Strings) and serial egress
+  //     (formatting and writing everything to the Interface)
+  //
+  // The stages are connected by the FromInterface and ToInterface line queues.
+  if (xTaskCreatePinnedToCore (RadioTask, "SMAC Radio", RADIO_TASK_STACK, this, RADIO_TASK_PRIORITY, &RadioTaskHandle, RADIO_TASK_CORE) != pdPASS)
+  {
+    Serial.println ("ERROR: Unable to start the radio task.");
+    return false;
+  }
+  FromInterface.SetConsumer (RadioTaskHandle);
+  UrgentFromInterface.SetConsumer (RadioTaskHandle);
+
+  if (xTaskCreatePinnedToCore (SerialTask, "SMAC Serial", SERIAL_TASK_STACK, this, SERIAL_TASK_PRIORITY, &SerialTaskHandle, SERIAL_TASK_CORE) != pdPASS)
+  {
+    Serial.println ("ERROR: Unable to start the serial task.");
+    return false;
+  }
+  ToInterface.SetConsumer (SerialTaskHandle);
+
+#ifndef HOST_LINK_USB
+  // Wake the serial task as soon as the UART has a burst of bytes
+  // (FIFO full or a short gap after the last byte) instead of waiting for its next tick
+  Serial.setRxTimeout (SERIAL_RX_TIMEOUT);
+  Serial.onReceive (SerialReceived);
+#endif
+
+  return true;
+}
+
+//--- radio_Run -------------------------------------------
+
+void Relayer::radio_Run ()
+{
+  int64_t now = esp_timer_get_time ();
+  Counters.CountLoop (now);
+
+  // Process any Command Strings from the Interface
+  radio_CheckCommands ();
+
+  // Process any Node messages received by ESP-NOW
+  espnow_CheckQueue ();
+
+  // Ask the next Nodes for System Info if discovery is running
+  if (discoveryRunning)
+    discovery_Service ();
+
+  // Send the aggregated Data Strings of windows that are over
+  stream_Service (now);
+
+  // Report Nodes that have gone silent
+  liveness_Service (now);
+
+  // Give up on long Data Strings that stopped arriving
+  Fragments.Expire (now);
+
+  // Drop Command Strings that sleepy Nodes didn't pick up in time
+  mailbox_Service (now);
+
+  // Slow the Nodes down while the radio or serial link is congested
+  throttle_Service (now);
+
+  // Step a channel survey, switch channels or visit the rendezvous channel when it's time
+  channel_Service (now);
+
+  // Retry and send any waiting ESP-NOW messages
+  Outbox.Service ();
+
+  // Periodic STAT report
+  if (statPeriod > 0 && now - lastStatTime >= statPeriod)
+  {
+    lastStatTime = now;
+    radio_SendStats ();
+  }
+}
+
+//--- serial_Run ------------------------------------------
 
-void Relayer::Run ()
+void Relayer::serial_Run ()
 {
   // Process any Interface commands from Serial port
   serial_CheckInput ();
+
+  // Format everything from the radio task into the TX buffer
+  serial_DrainLines ();
+
+  // Send any waiting output to the Interface
+  InterfaceLink.Service ();
 }
 
 //--- serial_CheckInput -----------------------------------
 
 void Relayer::serial_CheckInput ()
 {
-  // Check serial port for commands from the Interface
-  while (Serial.available ())
+  // Check serial port for commands from the Interface.
+  // Read everything waiting in one go and split it into lines.
+  char  readBuffer[SERIAL_READ_CHUNK];
+  int   numWaiting;
+
+  while ((numWaiting = Serial.available ()) > 0)
   {
-    serial_NextChar = (char) Serial.read ();
+    int numRead = Serial.read (readBuffer, (numWaiting < SERIAL_READ_CHUNK) ? numWaiting : SERIAL_READ_CHUNK);
+    if (numRead <= 0)
+      break;
+
+    Counters.cmdBytes += numRead;
 
-    if (serial_NextChar != '\r')  // ignore CR's
+    char *next = readBuffer;
+    char *end  = readBuffer + numRead;
+    char *newline;
+
+    while ((newline = (char *) memchr (next, '\n', end - next)) != NULL)
     {
-      if (serial_NextChar == '\n')
-      {
-        // Command is ready, terminate string and process it
-        commandString[commandLength] = 0;
+      // Command is ready, process it and start a new one
+      serial_AddChars (next, newline - next);
+      serial_EndLine  ();
+      next = newline + 1;
+    }
 
-        serial_ProcessCommand ();
+    // Keep the start of the next line
+    serial_AddChars (next, end - next);
+  }
+}
 
-        // Start new message
-        commandLength = 0;
-      }
-      else
-      {
-        // Add char to end of buffer
-        if (commandLength < MAX_MESSAGE_LENGTH - 1)
-          commandString[commandLength++] = serial_NextChar;
-        else  // too long
-        {
-          Serial.println ("S|--|--|ERROR: Serial message from Interface is too long.");
+//--- serial_AddChars -------------------------------------
 
-          // Ignore and start new message
-          commandLength = 0;
-        }
-      }
-    }
+void Relayer::serial_AddChars (const char *chars, int count)
+{
+  if (serialOverflow)
+    return;  // Ignore the rest of a line that is too long
+
+  if (serialLength + count > SERIAL_LINE_LENGTH - 1)
+  {
+    InterfaceLink.SendLine ("S|--|--|ERROR: Serial message from Interface is too long.");
+    ++Counters.parseErrors;
+
+    serialOverflow = true;
+    return;
+  }
+
+  memcpy (serialLine + serialLength, chars, count);
+  serialLength += count;
+}
+
+//--- serial_EndLine --------------------------------------
+
+void Relayer::serial_EndLine ()
+{
+  bool overflow = serialOverflow;
+  int  length   = serialLength;
+
+  // Start new message
+  serialOverflow = false;
+  serialLength   = 0;
+
+  if (overflow) return;
+
+  // Ignore CR's
+  while (length > 0 && serialLine[length-1] == '\r') --length;
+
+  serialLine[length] = 0;
+
+  if (strncmp (serialLine, BATCH_PREFIX, BATCH_PREFIX_LENGTH) != 0)
+  {
+    serial_ProcessLine (serialLine, length);
+    return;
+  }
+
+  // Batch line: B|command;command;...
+  // Each command is handled as if it had its own line.
+  char *command = serialLine + BATCH_PREFIX_LENGTH;
+  char *end     = serialLine + length;
+
+  while (command < end)
+  {
+    char *separator = (char *) memchr (command, BATCH_SEPARATOR, end - command);
+    if (separator == NULL) separator = end;
+
+    *separator = 0;
+    if (separator > command)
+      serial_ProcessLine (command, separator - command);
+
+    command = separator + 1;
   }
 }
 
-//--- serial_ProcessCommand -------------------------------
+//--- serial_ProcessLine ----------------------------------
 
-void Relayer::serial_ProcessCommand ()
+void Relayer::serial_ProcessLine (const char *line, int length)
 {
   // Incoming Command strings from the SMAC Interface have
   // the following format: (fields are separated with the '|' char)
   //
   //   ┌───────────────── 'C' for Command
-  //   │ ┌─────────────── 2-char target nodeID (00-19)
+  //   │ ┌─────────────── 2-char target nodeID (00-99)
   //   │ │  ┌──────────── 2-char target deviceID (00-99)
   //   │ │  │   ┌──────── 4-char command (usually capital letters)
   //   │ │  │   │     ┌── Optional variable length parameter string
   //   │ │  │   │     │
   //   C|nn|dd|CCCC|params
+  //
+  // A Command String prefixed with '~' is a setpoint (slider, dial, joystick): only the
+  // newest one for the same Node, Device and command is sent if the older one is still waiting.
+  //
+  // Only emergency stops and invalid lines are sorted out here; everything
+  // else is passed to the radio task in order.
+  ++Counters.cmdIn;
 
   // Check Command String length
-  if (commandLength < MIN_COMMAND_LENGTH)
-    Serial.println ("S|--|--|ERROR: Invalid Command String from Interface.");
-  else
+  if (length < MIN_COMMAND_LENGTH || length > MAX_MESSAGE_LENGTH - 1)
+  {
+    InterfaceLink.SendLine ("S|--|--|ERROR: Invalid Command String from Interface.");
+    ++Counters.parseErrors;
+  }
+  // Latest-wins commands (~C|nn|dd|cccc) are always for a Node
+  else if (line[0] == LATEST_PREFIX)
+  {
+    if (!FromInterface.Push (line, length, false, 0))
+      InterfaceLink.SendLine ("S|--|--|ERROR: Relayer is busy, command dropped.");
+  }
+  // Emergency stops (E|nn|dd|cccc) skip ahead of all other commands
+  else if (line[0] == 'E')
   {
-    // First check if requesting MAC address (from the Set MAC Tool)
-    if (strncmp (commandString + VC_OFFSET, "GMAC", COMMAND_SIZE) == 0)
+    if (!IsEStop (line, length))
     {
-      Serial.print   ("MAC=");
-      Serial.println (WiFi.macAddress ());
+      InterfaceLink.SendLine ("S|--|--|ERROR: Invalid emergency stop; use E|nn|dd|cccc (nn = 00-99, -- or G0-G9, dd = 00-99 or --)");
+      ++Counters.parseErrors;
     }
-    // Then check if the Interface is requesting all Node and Device Info (System Info)
-    else if (strncmp (commandString + VC_OFFSET, "SYSI", COMMAND_SIZE) == 0)
-    {
-      // Request Node and Device info from all registered Nodes
-      for (NodeIndex=0; NodeIndex<MAX_NODES; NodeIndex++)
-      {
-        if (NodeMACs[NodeIndex][0] != 0xFF)
-        {
-          sprintf (commandString, "C|%02d|--|GNOI", NodeIndex);  // Get Node Info
-          espnow_SendCommandString ();
+    else if (!UrgentFromInterface.Push (line, length, true, esp_timer_get_time ()))
+      InterfaceLink.SendLine ("S|--|--|ERROR: Relayer is busy, emergency stop dropped.");
+  }
+  // Everything else is for the radio task
+  // (serial link commands come back through ToInterface, see serial_RunCommand)
+  else if (!FromInterface.Push (line, length, false, 0))
+    InterfaceLink.SendLine ("S|--|--|ERROR: Relayer is busy, command dropped.");
+}
 
-          sprintf (commandString, "C|%02d|--|GDEI", NodeIndex);  // Get Device Info
-          espnow_SendCommandString ();
-        }
-      }
-    }
-    else
+//--- serial_DrainLines -----------------------------------
+
+void Relayer::serial_DrainLines ()
+{
+  // Format everything from the radio task into the TX buffer
+  Line *line;
+  for (int i=0; i<LINE_QUEUE_SLOTS && (line = ToInterface.Peek ()) != NULL; i++)
+  {
+    if (line->longText != NULL)
     {
-      //================================================
-      // Relay <CommandString> to specified Node/Device
-      //================================================
-      espnow_SendCommandString ();
+      // A reassembled Data String, handed back to the radio task once written
+      InterfaceLink.SendString (line->longText, line->length, line->timestamp);
+      *line->busy = false;
     }
+    else if (line->isCommand)
+      serial_RunCommand (line->text, line->length);
+    else if (line->hasTimestamp)
+      InterfaceLink.SendString (line->text, line->length, line->timestamp);
+    else
+      InterfaceLink.SendLine (line->text);
+
+    ToInterface.Pop ();
   }
 }
 
-//--- espnow_SendCommandString ----------------------------
+//--- serial_RunCommand -----------------------------------
 
-void Relayer::espnow_SendCommandString ()
+void Relayer::serial_RunCommand (const char *command, int length)
 {
-  // Check if Node exists and command is valid
-  NodeIndex = 10*((int)(commandString[2])-48) + ((int)(commandString[3])-48);
-  if (NodeIndex < MAX_NODES)
+  // Commands for the serial link itself (see IsLinkCommand).
+  // The radio task sends them back through ToInterface, so they are run,
+  // and their replies written, in order with the lines queued before them.
+  char  reply[MAX_MESSAGE_LENGTH];
+
+  // Check if requesting MAC address (from the Set MAC Tool)
+  if (strncmp (command + VC_OFFSET, "GMAC", COMMAND_SIZE) == 0)
+  {
+    sprintf (reply, "MAC=%s", WiFi.macAddress ().c_str ());
+    InterfaceLink.SendLine (reply);
+  }
+  // Check if the Interface is requesting the state of the serial TX buffer
+  else if (strncmp (command + VC_OFFSET, "GTXQ", COMMAND_SIZE) == 0)
+  {
+    // TXQ=backlog,maxBacklog,stalls,flushes
+    sprintf (reply, "S|--|--|TXQ=%d,%d,%lu,%lu", InterfaceLink.GetBacklog (), InterfaceLink.GetMaxBacklog (), (unsigned long) InterfaceLink.GetStalls (), (unsigned long) InterfaceLink.GetFlushes ());
+    InterfaceLink.SendLine (reply);
+  }
+  // Check if the Interface is requesting the depth of each pipeline stage
+  else if (strncmp (command + VC_OFFSET, "GPIP", COMMAND_SIZE) == 0)
+  {
+    // PIPE=rxDepth,rxHighWater,cmdDepth,cmdHighWater,urgentDepth,urgentHighWater,urgentDropped,outDepth,outHighWater,outDropped,txBacklog
+    sprintf (reply, "S|--|--|PIPE=%d,%lu,%d,%lu,%d,%lu,%lu,%d,%lu,%lu,%d",
+             ESPNOW_Queue.GetDepth (),        (unsigned long) ESPNOW_Queue.GetHighWater (),
+             FromInterface.GetDepth (),       (unsigned long) FromInterface.GetHighWater (),
+             UrgentFromInterface.GetDepth (), (unsigned long) UrgentFromInterface.GetHighWater (), (unsigned long) UrgentFromInterface.GetDropped (),
+             ToInterface.GetDepth (),         (unsigned long) ToInterface.GetHighWater (),         (unsigned long) ToInterface.GetDropped (),
+             InterfaceLink.GetBacklog ());
+    InterfaceLink.SendLine (reply);
+  }
+  // Check if the Interface is negotiating a new baud rate
+  else if (strncmp (command + VC_OFFSET, "SBAU", COMMAND_SIZE) == 0)
+    serial_SetBaudRate (command, length);
+  // Check if the Interface is setting the clock for timestamps
+  else if (strncmp (command + VC_OFFSET, "STIM", COMMAND_SIZE) == 0)
   {
-    if (NodeMACs[NodeIndex][0] != 0xFF)
+    // C|--|--|STIM|epochMilliseconds  --> S|--|--|TIME=epochMicroseconds
+    if (length > MIN_COMMAND_LENGTH)
     {
-      //========================================
-      // Relay command to specified Node/Device
-      //========================================
-      ESPNOW_Result = esp_now_send (NodeMACs[NodeIndex], (const uint8_t *)commandString, strlen(commandString) + 1);
-      if (ESPNOW_Result != ESP_OK)
-      {
-        Serial.print   ("S|--|--|ERROR: Unable to send Command String from Relayer: ");
-        Serial.println (commandString);
-      }
+      InterfaceLink.SetEpoch (atoll (command + MIN_COMMAND_LENGTH + 1) * 1000LL);
 
-      return;
+      sprintf (reply, "S|--|--|TIME=%lld", (long long) InterfaceLink.GetTime (esp_timer_get_time ()));
+      InterfaceLink.SendLine (reply);
     }
+    else
+      InterfaceLink.SendLine ("S|--|--|ERROR: Missing time for STIM.");
+  }
+  // Check if the Interface is switching the uplink between text and binary records
+  else if (strncmp (command + VC_OFFSET, "SUPM", COMMAND_SIZE) == 0)
+  {
+    // Acknowledge in the current mode, then switch
+    if (length > MIN_COMMAND_LENGTH && strcmp (command + MIN_COMMAND_LENGTH + 1, "BIN") == 0)
+    {
+      sprintf (reply, "S|--|--|UPLINK=BIN,%d", UPLINK_VERSION);
+      InterfaceLink.SendLine (reply);
+      InterfaceLink.SetMode  (UPLINK_BINARY);
+    }
+    else if (length > MIN_COMMAND_LENGTH && strcmp (command + MIN_COMMAND_LENGTH + 1, "TEXT") == 0)
+    {
+      InterfaceLink.SendLine ("S|--|--|UPLINK=TEXT");
+      InterfaceLink.SetMode  (UPLINK_TEXT);
+    }
+    else
+      InterfaceLink.SendLine ("S|--|--|ERROR: Invalid uplink mode; use BIN or TEXT.");
   }
-
-  Serial.println ("S|--|--|ERROR: Unable to send command; Node does not exist.");
 }
 
+//--- serial_SetBaudRate ----------------------------------
 
-//=========================================================
-// External "C" Functions
-//=========================================================
-
-//--- ESPNOW_Receiver -------------------------------------
-
-IRAM_ATTR void ESPNOW_Receiver (const esp_now_recv_info_t *info, const uint8_t *espnowString, int stringLength)
+void Relayer::serial_SetBaudRate (const char *line, int length)
 {
-  // The Relayer can receive both Data and Commands from Nodes and Devices.
-  // Data strings are relayed to the SMAC Interface with "|timestamp" appended.
-  // Command strings are relayed to the target Node and Device, or broadcasted.
-  //
-  //-------------------------
-  //  Data string format:
-  //-------------------------
-  //
-  //   ┌──────────── 1-char packet type ('W' for Widget Data, 'S' for System Data)
-  //   │ ┌────────── 2-char source nodeID (00-19)
-  //   │ │  ┌─────── 2-char source deviceID (00-99)
-  //   │ │  │    ┌── variable length string of values (multiple values are comma delimited)
-  //   │ │  │    │
-  //   d|nn|dd|values
-  //
-  // A bar char '|" and a variable length timestamp field is appended to the string
-  // before being relayed to the SMAC Interface.
-  //
-  // Special Data:
-  // --------------------------------
-  //   PING - A new Node just started and is waiting for a PONG from the Relayer
-  //
-  //-------------------------
-  //  Command string format:
-  //-------------------------
+  // C|--|--|SBAU|rate
   //
-  //   ┌───────────────── 1-char packet type ('C' for Command)
-  //   │ ┌─────────────── 2-char target nodeID (00-19), if "--" then the command is broadcasted
-  //   │ │  ┌──────────── 2-char target deviceID (00-99)
-  //   │ │  │   ┌──────── 4-char command (usually capital letters)
-  //   │ │  │   │     ┌── optional variable length string of parameters (multiple params are comma delimited)
-  //   │ │  │   │     │
-  //   C|nn|dd|cccc|params
+  // For UART bridge boards, the new rate is acknowledged at the old rate:
+  //   S|--|--|BAUD=rate
+  // then the Relayer switches.  The Interface must re-open the port at the new rate.
   //
-  // Special Commands:
-  // --------------------------------
-  //   WFCH|n - A Node has requested every ESP-NOW peer to change their WiFi Channel to n (0-14)
-  //            This Command String is broadcasted to all peers including this Relayer
+  // Native USB runs at full USB speed whatever the rate, so it just answers:
+  //   S|--|--|BAUD=USB
+  static const unsigned long  validRates[] = { 115200, 230400, 460800, 921600, 1500000, 2000000 };
 
+  unsigned long newRate = (length > MIN_COMMAND_LENGTH) ? strtoul (line + MIN_COMMAND_LENGTH + 1, NULL, 10) : 0;
 
-  // ASAP, Set timestamp field that gets appended to Data strings
-  ltoa (millis(), TimestampField + 1, 10);  // +1 to skip over '|' char
+  bool valid = false;
+  for (int i=0; i<(int)(sizeof(validRates)/sizeof(validRates[0])); i++)
+    if (validRates[i] == newRate) valid = true;
 
-  // Check if being called again before finishing.
-  // If you see this message then reduce the periodic
-  // data rate for your devices.
-  if (ProcessingESPNOWString)
+  if (!valid)
   {
-    Serial.println ("S|--|--|ERROR: ESP-NOW Message overflow.");
+    InterfaceLink.SendLine ("S|--|--|ERROR: Unsupported baud rate.");
     return;
   }
 
-  // Lock
-  ProcessingESPNOWString = true;
+#ifdef HOST_LINK_USB
+  InterfaceLink.SendLine ("S|--|--|BAUD=USB");
+#else
+  char reply[MAX_MESSAGE_LENGTH];
+  Budget.SetSerialRate (newRate);
+  sprintf (reply, "S|--|--|BAUD=%lu", newRate);
 
-  // Check minimum string length
-  if (stringLength < MIN_DATA_LENGTH)
+  // Everything queued before SBAU is already written; it and the reply go out at the old rate
+  InterfaceLink.SendLine (reply);
+  InterfaceLink.Flush (true);
+  Serial.flush ();
+
+  Serial.updateBaudRate (newRate);
+#endif
+}
+
+//--- radio_CheckCommands ---------------------------------
+
+void Relayer::radio_CheckCommands ()
+{
+  // Emergency stops first
+  Line *line;
+  while ((line = UrgentFromInterface.Peek ()) != NULL)
   {
-    Serial.println ("S|--|--|ERROR: Node/Device String too short.");
-    ProcessingESPNOWString = false;
-    return;
+    estop_Send (line->text, line->timestamp);
+    UrgentFromInterface.Pop ();
   }
 
-  // Get the Node index
-  NodeIndex = 10*((int)(espnowString[2])-48) + ((int)(espnowString[3])-48);
-  if (NodeIndex >= MAX_NODES)
+  // Then the Command Strings passed on by the serial task
+  for (int i=0; i<LINE_QUEUE_SLOTS && (line = FromInterface.Peek ()) != NULL; i++)
   {
-    Serial.println ("S|--|--|ERROR: Invalid NodeID in Node message.");
-    ProcessingESPNOWString = false;
-    return;
+    // A setpoint that may replace an older one still waiting for the Node
+    commandLatest = (line->text[0] == LATEST_PREFIX);
+
+    commandLength = line->length - (commandLatest ? 1 : 0);
+    memcpy (commandString, line->text + (commandLatest ? 1 : 0), commandLength + 1);
+    FromInterface.Pop ();
+
+    radio_ProcessCommand ();
   }
+}
 
-  //===================================
-  // Handle Data strings
-  //===================================
-  if ((char) espnowString[0] == 'W' || (char) espnowString[0] == 'S')
-  {
-    // Handle "PING" from a new Node: S|nn|--|PING or unregistered Node
-    if ((strcmp ((const char *) espnowString + VC_OFFSET, "PING") == 0) || NodeMACs[NodeIndex][0] == 0xFF)
-    {
-      // Haven't heard from this Node yet, so register it as a new peer
-      // Save MAC address in array
-      uint8_t *nodeMAC = (*info).src_addr;
-      memcpy (NodeMACs[NodeIndex], nodeMAC, MAC_SIZE);
+//--- radio_ProcessCommand --------------------------------
 
-      // Register new Node as an esp_now peer (if not already a peer)
-      if (!esp_now_is_peer_exist (nodeMAC))
-      {
-        memcpy (PeerInfo.peer_addr, nodeMAC, MAC_SIZE);
-        ESPNOW_Result = esp_now_add_peer (&PeerInfo);
-        if (ESPNOW_Result != ESP_OK)
-        {
-          Serial.print   ("S|--|--|ERROR: Unable to add Node as ESP-NOW peer: ");
-          Serial.println (ESPNOW_Result);
-          return;
-        }
-      }
+void Relayer::radio_ProcessCommand ()
+{
+  // Relayer commands that need the radio side, and Command Strings for Nodes.
+  // The Command String has already been checked by serial_ProcessLine().
 
-      // Send back a "PONG" to the Node
-      ESPNOW_Result = esp_now_send (NodeMACs[NodeIndex], (const uint8_t *) "PONG", COMMAND_SIZE);
-      if (ESPNOW_Result != ESP_OK)
-      {
-        Serial.print   ("S|--|--|ERROR: Unable to send PONG to new Node ");
-        Serial.println (NodeIndex);
-        return;
-      }
+  // Serial link commands go back to the serial task, behind the lines already queued for the Interface
+  if (IsLinkCommand (commandString))
+    ToInterface.SendCommand (commandString, commandLength);
+  // Check if the Interface is requesting the state of the ESP-NOW receive queue
+  else if (strncmp (commandString + VC_OFFSET, "GRXQ", COMMAND_SIZE) == 0)
+  {
+    // RXQ=depth,highWater,dropped
+    sprintf (DataString, "S|--|--|RXQ=%d,%lu,%lu", ESPNOW_Queue.GetDepth (), (unsigned long) ESPNOW_Queue.GetHighWater (), (unsigned long) ESPNOW_Queue.GetDropped ());
+    ToInterface.SendLine (DataString);
+  }
+  // Check if the Interface is requesting the link statistics of all Nodes
+  else if (strncmp (commandString + VC_OFFSET, "GLNK", COMMAND_SIZE) == 0)
+    radio_SendLinkStats ();
+  // Check if the Interface is requesting the state of the ESP-NOW send queue
+  else if (strncmp (commandString + VC_OFFSET, "GSDQ", COMMAND_SIZE) == 0)
+  {
+    // SDQ=waiting,inFlight,window,sent,delivered,retries,lost,dropped,coalesced,late
+    sprintf (DataString, "S|--|--|SDQ=%d,%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu", Outbox.GetWaiting (), Outbox.GetInFlight (), Outbox.GetWindow (),
+             (unsigned long) Outbox.GetSent (), (unsigned long) Outbox.GetDelivered (), (unsigned long) Outbox.GetRetries (),
+             (unsigned long) Outbox.GetLost (), (unsigned long) Outbox.GetDropped (), (unsigned long) Outbox.GetCoalesced (),
+             (unsigned long) Outbox.GetLate ());
+    ToInterface.SendLine (DataString);
+  }
+  // Check if the Interface is requesting the fragment reassembly counters
+  else if (strncmp (commandString + VC_OFFSET, "GFRG", COMMAND_SIZE) == 0)
+  {
+    // FRAG=messages,fragments,timeouts,noSlot,invalid
+    sprintf (DataString, "S|--|--|FRAG=%lu,%lu,%lu,%lu,%lu", (unsigned long) Fragments.GetMessages (), (unsigned long) Fragments.GetFragments (),
+             (unsigned long) Fragments.GetTimeouts (), (unsigned long) Fragments.GetNoSlot (), (unsigned long) Fragments.GetInvalid ());
+    ToInterface.SendLine (DataString);
+  }
+  // Check if the Interface is setting the number of in-flight ESP-NOW messages per Node
+  else if (strncmp (commandString + VC_OFFSET, "SWIN", COMMAND_SIZE) == 0)
+  {
+    // C|--|--|SWIN|n  --> S|--|--|WINDOW=n
+    if (commandLength > MIN_COMMAND_LENGTH)
+      Outbox.SetWindow (atoi (commandString + MIN_COMMAND_LENGTH + 1));
 
-      // Send System Data message to Interface to indicate
-      // that a new Node has connected: S|nn|--|NEWNODE
-      sprintf (DataString, "S|%02d|--|NEWNODE", NodeIndex);
-      Serial.println (DataString);
-    }
-    else
+    sprintf (DataString, "S|--|--|WINDOW=%d", Outbox.GetWindow ());
+    ToInterface.SendLine (DataString);
+  }
+  // Check if the Interface is requesting the emergency stop latency
+  else if (strncmp (commandString + VC_OFFSET, "GEST", COMMAND_SIZE) == 0)
+  {
+    // ESTOPLAT=sent,acks,lastLatency,maxLatency  (microseconds)
+    sprintf (DataString, "S|--|--|ESTOPLAT=%lu,%lu,%ld,%ld", (unsigned long) estopSent, (unsigned long) estopAcks, (long) estopLastLatency, (long) estopMaxLatency);
+    ToInterface.SendLine (DataString);
+  }
+  // Check if the Interface is requesting the performance counters
+  else if (strncmp (commandString + VC_OFFSET, "STAT", COMMAND_SIZE) == 0)
+  {
+    // C|--|--|STAT[|ms]  Optional period of automatic reports, 0 = off
+    if (commandLength > MIN_COMMAND_LENGTH)
     {
-      //=====================================================
-      // Append timestamp and relay Data String to Interface
-      //=====================================================
-      memcpy (DataString, espnowString, stringLength);
-      DataString[stringLength] = 0;
-      strcat (DataString, TimestampField);  // TimestampField includes the initial '|' char
-      Serial.println (DataString);
+      long period = atol (commandString + MIN_COMMAND_LENGTH + 1);
+      if (period > 0 && period < MIN_STAT_PERIOD)
+        period = MIN_STAT_PERIOD;
+
+      statPeriod   = (period > 0) ? (int64_t) period * 1000LL : 0;
+      lastStatTime = esp_timer_get_time ();
     }
+
+    radio_SendStats ();
   }
+  // Check if the Interface is setting or listing Widget Data aggregation policies
+  else if (strncmp (commandString + VC_OFFSET, "SAGG", COMMAND_SIZE) == 0)
+    stream_SetPolicy ();
+  else if (strncmp (commandString + VC_OFFSET, "GAGG", COMMAND_SIZE) == 0)
+    stream_SendList ();
+  // Check if the Interface wants all Widget Data at full rate
+  else if (strncmp (commandString + VC_OFFSET, "FULL", COMMAND_SIZE) == 0)
+  {
+    // C|--|--|FULL|1 or 0  --> S|--|--|FULL=1 or 0
+    if (commandLength > MIN_COMMAND_LENGTH)
+      Streams.SetFullRate (atoi (commandString + MIN_COMMAND_LENGTH + 1) != 0);
 
-  //===================================
-  // Handle Command strings
-  //===================================
-  else if ((char) espnowString[0] == 'C')
+    sprintf (DataString, "S|--|--|FULL=%d", Streams.IsFullRate () ? 1 : 0);
+    ToInterface.SendLine (DataString);
+  }
+  // Check if the Interface is setting or listing the PHY rates of the Nodes
+  else if (strncmp (commandString + VC_OFFSET, "SPHY", COMMAND_SIZE) == 0)
+    rate_Set ();
+  else if (strncmp (commandString + VC_OFFSET, "GPHY", COMMAND_SIZE) == 0)
+    rate_SendList ();
+  // Check if the Interface is setting up, deleting or listing groups
+  else if (strncmp (commandString + VC_OFFSET, "SGRP", COMMAND_SIZE) == 0)
+    group_Define ();
+  else if (strncmp (commandString + VC_OFFSET, "DGRP", COMMAND_SIZE) == 0)
+    group_Delete ();
+  else if (strncmp (commandString + VC_OFFSET, "GGRP", COMMAND_SIZE) == 0)
+    group_SendList ();
+  // Check if the Interface is surveying the WiFi channels
+  else if (strncmp (commandString + VC_OFFSET, "SURV", COMMAND_SIZE) == 0)
+    channel_StartSurvey ();
+  // Check if the Interface is moving the whole SMAC network to another WiFi channel
+  else if (strncmp (commandString + VC_OFFSET, "WFCH", COMMAND_SIZE) == 0 && commandString[2] == '-')
+    channel_Schedule ((commandLength > MIN_COMMAND_LENGTH) ? commandString + MIN_COMMAND_LENGTH + 1 : "");
+  // Check if the Interface is setting or listing the liveness of the Nodes
+  else if (strncmp (commandString + VC_OFFSET, "SLIV", COMMAND_SIZE) == 0)
+    liveness_Set ();
+  else if (strncmp (commandString + VC_OFFSET, "GLIV", COMMAND_SIZE) == 0)
+    liveness_SendList ();
+  // Check if the Interface is setting or reading the congestion throttle
+  else if (strncmp (commandString + VC_OFFSET, "STHR", COMMAND_SIZE) == 0)
+    throttle_Set ();
+  else if (strncmp (commandString + VC_OFFSET, "GTHR", COMMAND_SIZE) == 0)
+    throttle_Report ();
+  // Check if the Interface is setting or listing the mailboxes of sleepy Nodes
+  else if (strncmp (commandString + VC_OFFSET, "SMBX", COMMAND_SIZE) == 0)
+    mailbox_Set ();
+  else if (strncmp (commandString + VC_OFFSET, "GMBX", COMMAND_SIZE) == 0)
+    mailbox_SendList ();
+  // Check if the Interface is requesting the latest Widget Data of a Device
+  else if (strncmp (commandString + VC_OFFSET, "GLVA", COMMAND_SIZE) == 0)
+    twin_SendLastValue ();
+  // Check if the Interface is setting or reading the link budget
+  else if (strncmp (commandString + VC_OFFSET, "SBUD", COMMAND_SIZE) == 0)
+    budget_Set ();
+  else if (strncmp (commandString + VC_OFFSET, "GBUD", COMMAND_SIZE) == 0)
+    budget_SendReport ();
+  // Then check if the Interface is requesting all Node and Device Info (System Info)
+  else if (strncmp (commandString + VC_OFFSET, "SYSI", COMMAND_SIZE) == 0)
+    discovery_Start ();
+  else
   {
-    // Echo command to Interface (for Diagnostic Monitor)
-    memcpy (DataString, espnowString, stringLength);
-    DataString[stringLength] = 0;
-    Serial.println (DataString);
+    //================================================
+    // Relay <CommandString> to specified Node/Device
+    //================================================
+    espnow_SendCommandString ();
+  }
+}
 
-    // Check data length
-    if (stringLength < MIN_COMMAND_LENGTH)
-      Serial.println ("S|--|--|ERROR: Node/Device Command String too short.");
-    else if (strncmp ((const char *) espnowString + VC_OFFSET, "WFCH", COMMAND_SIZE) == 0)
+//--- radio_SendLinkStats --------------------------------
+
+void Relayer::radio_SendLinkStats ()
+{
+  // One line per registered Node:
+  // S|nn|--|LINK=mac,rssi,noiseFloor,framesPerSec,frames,bytes,sendFailures,msSinceLastSeen,unconfirmed
+  int64_t now = esp_timer_get_time ();
+
+  for (int i=0; i<MAX_NODES; i++)
+  {
+    if (Peers.IsRegistered (i))
     {
-      // Change WiFi Channel
-      uint8_t newChannel = (uint8_t) atoi ((const char *) espnowString + 13);
-      Serial.print ("New WiFi Channel rquested; Changing to channel "); Serial.println (newChannel);
-      esp_wifi_set_channel (newChannel, WIFI_SECOND_CHAN_NONE);
+      Peer *peer = Peers.GetPeer (i);
+
+      sprintf (DataString, "S|%02d|--|LINK=%02X:%02X:%02X:%02X:%02X:%02X,%d,%d,%.1f,%lu,%lu,%lu,%ld,%lu", i,
+               peer->mac[0], peer->mac[1], peer->mac[2], peer->mac[3], peer->mac[4], peer->mac[5],
+               peer->rssi, peer->noiseFloor, Peers.GetFramesPerSecond (i, now),
+               (unsigned long) peer->numFrames, (unsigned long) peer->numBytes, (unsigned long) peer->numSendFailures,
+               (peer->lastSeen == 0) ? -1L : (long)((now - peer->lastSeen) / 1000LL), (unsigned long) peer->numUnconfirmed);
+      ToInterface.SendLine (DataString);
     }
-    else
-    {
-      // Check if target Node exists
-      if (NodeMACs[NodeIndex][0] != 0xFF)
-      {
-        //=====================================================
-        // Relay Command String to target Node/Device
-        //=====================================================
-        esp_now_send (NodeMACs[NodeIndex], (const uint8_t *) espnowString, stringLength);
-      }
-      else
-        Serial.println ("S|--|--|ERROR: Unable to relay command; Node does not exist.");
+  }
+}
+
+//--- radio_SendStats ------------------------------------
+
+void Relayer::radio_SendStats ()
+{
+  // S|--|--|STAT=... (fields are listed in Stats.h)
+  snprintf (DataString, sizeof(DataString), "S|--|--|STAT=%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu",
+            (unsigned long)(esp_timer_get_time () / 1000000LL), (unsigned long) Counters.GetLoopsPerSecond (),
+            (unsigned long) Counters.rxData, (unsigned long) Counters.rxSystem, (unsigned long) Counters.rxCommands, (unsigned long) Counters.rxBytes,
+            (unsigned long) Counters.txRecords, (unsigned long) InterfaceLink.GetBytes (),
+            (unsigned long) Counters.cmdIn, (unsigned long) Counters.cmdBytes,
+            (unsigned long) Outbox.GetSent (), (unsigned long) Outbox.GetBytesSent (),
+            (unsigned long) ESPNOW_Queue.GetDropped (), (unsigned long) Counters.dropInvalid, (unsigned long) Counters.dropNoNode,
+            (unsigned long)(Outbox.GetDropped () + Outbox.GetLost ()),
+            (unsigned long) InterfaceLink.GetStalls (), (unsigned long) Counters.parseErrors, (unsigned long) InterfaceLink.GetMaxLatency (),
+            (unsigned long) Counters.txUnconfirmed,
+            (unsigned long) Counters.relayedData, (unsigned long) Counters.relayedSystem,
+            (unsigned long) Counters.relayedCommands, (unsigned long) Counters.relayedEStops);
+  ToInterface.SendLine (DataString);
+}
+
+//--- espnow_SendCommandString ----------------------------
+
+void Relayer::espnow_SendCommandString ()
+{
+  // Commands for all Nodes or a group go out as one broadcast frame
+  if (espnow_SendMulticast (commandString, commandLength + 1))
+    return;
+
+  // Check if Node exists and command is valid
+  NodeIndex = 10*((int)(commandString[2])-48) + ((int)(commandString[3])-48);
+  if (NodeIndex < MAX_NODES)
+  {
+    if (Peers.IsRegistered (NodeIndex))
+    {
+      // A new periodic rate must fit in the link budget
+      if (strncmp (commandString + VC_OFFSET, "SRAT", COMMAND_SIZE) == 0 && !budget_CheckRate ())
+        return;
+
+      // A sleepy Node gets it when it listens
+      if (mailbox_Put (NodeIndex, commandString, commandLength, commandLatest))
+      {
+        ++Counters.relayedCommands;
+        return;
+      }
+
+      //========================================
+      // Relay command to specified Node/Device
+      //========================================
+      ESPNOW_Result = espnow_SendToNode (NodeIndex, commandString, strlen(commandString) + 1, SEND_RELIABLE, commandLatest);
+      if (ESPNOW_Result != ESP_OK)
+      {
+        Peers.RecordSendFailure (NodeIndex);
+
+        sprintf (DataString, "S|--|--|ERROR: Unable to send Command String from Relayer: %.200s", commandString);
+        ToInterface.SendLine (DataString);
+      }
+      else
+        ++Counters.relayedCommands;
+
+      return;
+    }
+  }
+
+  ToInterface.SendLine ("S|--|--|ERROR: Unable to send command; Node does not exist.");
+  ++Counters.dropNoNode;
+}
+
+//--- espnow_SendMulticast --------------------------------
+
+bool Relayer::espnow_SendMulticast (const char *string, int length)
+{
+  // Broadcasts a Command String for all Nodes (C|--|dd|...) or a group (C|Gg|--|...)
+  // in a single frame, so every target gets it at the same time.
+  // Returns false if the Command String is for a single Node.
+  if (!IsMulticast (string))
+    return false;
+
+  if (string[2] == 'G' && !Groups.IsDefined (string[3] - '0'))
+  {
+    sprintf (DataString, "S|--|--|ERROR: Unable to send command; Group G%c does not exist.", string[3]);
+    ToInterface.SendLine (DataString);
+    ++Counters.dropNoNode;
+    return true;
+  }
+
+  // Broadcasts have no delivery status; members reply with their own data
+  if (Outbox.Send (NULL, string, length, SEND_BEST_EFFORT) != ESP_OK)
+  {
+    sprintf (DataString, "S|--|--|ERROR: Unable to broadcast Command String: %.200s", string);
+    ToInterface.SendLine (DataString);
+  }
+  else
+    ++Counters.relayedCommands;
+
+  return true;
+}
+
+//--- estop_Send ------------------------------------------
+
+void Relayer::estop_Send (const char *line, int64_t receivedTime)
+{
+  // E|nn|dd|cccc  -->  E|nn|dd|cccc|seq  to the target Node, all Nodes (--) or a group (Gg).
+  //
+  // It goes out ahead of everything else, in several ways at once:
+  //   ∙ ESTOP_BROADCASTS broadcast copies, which need no ESP-NOW peer
+  //   ∙ a priority unicast to every target Node, retried right away if it fails
+  // Nodes execute the first copy and ignore the rest (same seq).
+  char      message[MIN_COMMAND_LENGTH+8];
+  uint16_t  seq = nextEStopSeq++;
+  if (nextEStopSeq == 0) nextEStopSeq = 1;
+
+  int length = sprintf (message, "%.*s|%u", MIN_COMMAND_LENGTH, line, seq) + 1;
+
+  for (int i=0; i<ESTOP_BROADCASTS; i++)
+    Outbox.Send (NULL, message, length, SEND_PRIORITY);
+
+  EStopRecord *record = &estops[seq % ESTOP_TRACK];
+  record->seq          = seq;
+  record->receivedTime = receivedTime;
+  record->numTargets   = 0;
+  record->numAcks      = 0;
+
+  int nodeIndex = ParseID (line + 2);
+  for (int i=0; i<MAX_NODES; i++)
+  {
+    bool target = (nodeIndex >= 0) ? (i == nodeIndex) : (line[2] == 'G') ? Groups.HasNode (line[3] - '0', i) : (line[2] == '-');
+    if (!target || !Peers.IsRegistered (i))
+      continue;
+
+    ++record->numTargets;
+    if (espnow_SendToNode (i, message, length, SEND_PRIORITY) != ESP_OK)
+      Peers.RecordSendFailure (i);
+  }
+
+  ++estopSent;
+  ++Counters.relayedEStops;
+
+  if (record->numTargets == 0)
+    ToInterface.SendLine ("S|--|--|ERROR: Emergency stop was broadcast, but no registered Node is a target.");
+}
+
+//--- estop_CheckAck --------------------------------------
+
+void Relayer::estop_CheckAck (int nodeIndex, RxFrame *frame)
+{
+  // S|nn|dd|ESTOP=seq  -->  S|nn|dd|ESTOP=seq,latency
+  // The latency runs from the serial task reading the emergency stop
+  // to the radio receiving the Node's report (microseconds).
+  unsigned int  seq    = (unsigned int) atoi (frame->data + VC_OFFSET + 6);
+  EStopRecord  *record = &estops[seq % ESTOP_TRACK];
+
+  if (record->seq != seq || record->receivedTime == 0)
+  {
+    ToInterface.SendString (frame->data, frame->length, frame->timestamp);
+    Counters.CountRecord ('S');
+    return;
+  }
+
+  int64_t latency = frame->timestamp - record->receivedTime;
+
+  ++record->numAcks;
+  ++estopAcks;
+  estopLastLatency = latency;
+  if (latency > estopMaxLatency)
+    estopMaxLatency = latency;
+
+  char  report[MAX_ESPNOW_LENGTH+1];
+  int   length = snprintf (report, sizeof(report), "S|%02d|%.2s|ESTOP=%u,%lld", nodeIndex, frame->data + 5, seq, (long long) latency);
+
+  ToInterface.SendString (report, length, frame->timestamp);
+  Counters.CountRecord ('S');
+}
+
+//--- stream_SetPolicy ------------------------------------
+
+void Relayer::stream_SetPolicy ()
+{
+  // C|--|--|SAGG|nn.dd,mode[,setting]  -->  S|--|--|AGG=nn.dd,mode,setting
+  const char  *params = commandString + MIN_COMMAND_LENGTH + 1;
+  int          nodeIndex   = (commandLength > MIN_COMMAND_LENGTH + 6) ? ParseID (params)     : -1;
+  int          deviceIndex = (commandLength > MIN_COMMAND_LENGTH + 6) ? ParseID (params + 3) : -1;
+
+  if (nodeIndex < 0 || deviceIndex < 0 || params[2] != '.' || params[5] != ',')
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid stream for SAGG; use nn.dd");
+    return;
+  }
+
+  const char  *modeName = params + 6;
+  const char  *setting  = strchr (modeName, ',');
+  long         value    = (setting == NULL) ? 0 : atol (setting + 1);
+  AggMode      mode;
+
+  if (strncmp (modeName, "PASS", 4) == 0)
+    mode = AGG_PASS;
+  else if (strncmp (modeName, "DEC,", 4) == 0 && value >= 1)
+    mode = AGG_DECIMATE;
+  else if (strncmp (modeName, "AVG,", 4) == 0 && value >= AGG_MIN_WINDOW)
+    mode = AGG_MEAN;
+  else if (strncmp (modeName, "MMM,", 4) == 0 && value >= AGG_MIN_WINDOW)
+    mode = AGG_MIN_MEAN_MAX;
+  else
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid SAGG mode; use PASS, DEC,n, AVG,ms or MMM,ms");
+    return;
+  }
+
+  // Windows are kept in microseconds
+  uint32_t policySetting = (mode == AGG_MEAN || mode == AGG_MIN_MEAN_MAX) ? (uint32_t) value * 1000 : (uint32_t) value;
+
+  // Send what is left of the old window first
+  AggStream *stream = Streams.Find (nodeIndex, deviceIndex);
+  if (stream != NULL && stream->count > 0 && stream->mode != AGG_DECIMATE)
+    stream_Send (stream);
+
+  if (!Streams.SetPolicy (nodeIndex, deviceIndex, mode, policySetting))
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: No free stream slot for SAGG.");
+    return;
+  }
+
+  sprintf (DataString, "S|--|--|AGG=%02d.%02d,%s,%ld", nodeIndex, deviceIndex, AggModeNames[mode], (mode == AGG_PASS) ? 0L : value);
+  ToInterface.SendLine (DataString);
+}
+
+//--- stream_SendList -------------------------------------
+
+void Relayer::stream_SendList ()
+{
+  // One line per policy: S|--|--|AGG=nn.dd,mode,setting,stringsIn,stringsOut
+  for (int i=0; i<AGG_SLOTS; i++)
+  {
+    AggStream *stream = Streams.GetStream (i);
+    if (stream == NULL)
+      continue;
+
+    sprintf (DataString, "S|--|--|AGG=%02d.%02d,%s,%lu,%lu,%lu", stream->nodeIndex, stream->deviceIndex, AggModeNames[stream->mode],
+             (unsigned long)((stream->mode == AGG_DECIMATE) ? stream->setting : stream->setting / 1000),
+             (unsigned long) stream->numIn, (unsigned long) stream->numOut);
+    ToInterface.SendLine (DataString);
+  }
+}
+
+//--- stream_Service --------------------------------------
+
+void Relayer::stream_Service (int64_t now)
+{
+  // Windows close when the next Data String arrives, or here if the stream goes quiet
+  for (int i=0; i<AGG_SLOTS; i++)
+  {
+    AggStream *stream = Streams.GetStream (i);
+    if (stream != NULL && Streams.IsDue (stream, now))
+      stream_Send (stream);
+  }
+}
+
+//--- stream_Send -----------------------------------------
+
+void Relayer::stream_Send (AggStream *stream)
+{
+  char  record[MAX_ESPNOW_LENGTH+1];
+  int   length = Streams.TakeRecord (stream, record);
+
+  ToInterface.SendString (record, length, stream->lastTime);
+  Counters.CountRecord (record[0]);
+}
+
+//--- rate_Set --------------------------------------------
+
+void Relayer::rate_Set ()
+{
+  // C|--|--|SPHY|nn,rate  -->  S|--|--|PHY=nn,rate
+  //
+  // <rate> is one of the rates in RateControl.h (e.g. LR250, 1M, 11M, 54M, MCS7) to fix the
+  // rate of Node nn, or AUTO to let it follow the link again.  "--" sets all Nodes.
+  const char  *params   = commandString + MIN_COMMAND_LENGTH + 1;
+  bool         allNodes = (params[0] == '-' && params[1] == '-');
+  int          nodeIndex, level;
+
+  if (commandLength < MIN_COMMAND_LENGTH + 5 || params[2] != ',')
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid SPHY; use nn,rate or nn,AUTO");
+    return;
+  }
+
+  nodeIndex = ParseID (params);
+  if (!allNodes && !Peers.IsRegistered (nodeIndex))
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Unable to set PHY rate; Node does not exist.");
+    return;
+  }
+
+  level = (strcmp (params + 3, "AUTO") == 0) ? -1 : RateControl::FindLevel (params + 3);
+  if (level < 0 && strcmp (params + 3, "AUTO") != 0)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Unknown PHY rate for SPHY.");
+    return;
+  }
+
+  Rates.SetFixed (allNodes ? NULL : Peers.GetMAC (nodeIndex), level);
+
+  sprintf (DataString, "S|--|--|PHY=%.2s,%s", params, (level < 0) ? "AUTO" : RateControl::GetName (level));
+  ToInterface.SendLine (DataString);
+}
+
+//--- rate_SendList ---------------------------------------
+
+void Relayer::rate_SendList ()
+{
+  // One line per Node with a rate: S|nn|--|PHY=rate,AUTO or FIXED,rssi,stepsUp,stepsDown
+  for (int i=0; i<MAX_NODES; i++)
+  {
+    PeerRate *rate = Peers.IsRegistered (i) ? Rates.GetRate (Peers.GetMAC (i)) : NULL;
+    if (rate == NULL)
+      continue;
+
+    sprintf (DataString, "S|%02d|--|PHY=%s,%s,%d,%lu,%lu", i, RateControl::GetName (rate->level), rate->automatic ? "AUTO" : "FIXED",
+             rate->rssi, (unsigned long) rate->numUp, (unsigned long) rate->numDown);
+    ToInterface.SendLine (DataString);
+  }
+}
+
+//--- group_Define ----------------------------------------
+
+void Relayer::group_Define ()
+{
+  // C|--|--|SGRP|name,nn.dd,nn.dd,...  -->  S|--|--|GROUP=name,Gg,numMembers
+  char  *name    = commandString + MIN_COMMAND_LENGTH + 1;
+  char  *members = (commandLength > MIN_COMMAND_LENGTH) ? strchr (name, ',') : NULL;
+
+  if (members == NULL)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Missing group name or members for SGRP.");
+    return;
+  }
+  *members++ = 0;
+
+  // Remember the old members, they may need to leave
+  bool  wasMember[MAX_NODES] = {};
+  int   oldIndex = Groups.Find (name);
+  for (int i=0; i<MAX_NODES && oldIndex >= 0; i++)
+    wasMember[i] = Groups.HasNode (oldIndex, i);
+
+  int groupIndex = Groups.Define (name, members);
+  if (groupIndex < 0)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid group members, or no free group.");
+    return;
+  }
+
+  // Tell every old and new member Node its part of the group
+  for (int i=0; i<MAX_NODES; i++)
+    if (wasMember[i] || Groups.HasNode (groupIndex, i))
+      group_SendMembership (groupIndex, i);
+
+  sprintf (DataString, "S|--|--|GROUP=%s,G%d,%d", name, groupIndex, Groups.GetGroup (groupIndex)->numMembers);
+  ToInterface.SendLine (DataString);
+}
+
+//--- group_Delete ----------------------------------------
+
+void Relayer::group_Delete ()
+{
+  // C|--|--|DGRP|name  -->  S|--|--|GROUP=name,deleted
+  const char *name = commandString + MIN_COMMAND_LENGTH + 1;
+
+  int groupIndex = (commandLength > MIN_COMMAND_LENGTH) ? Groups.Find (name) : -1;
+  if (groupIndex < 0)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Group does not exist.");
+    return;
+  }
+
+  bool wasMember[MAX_NODES];
+  for (int i=0; i<MAX_NODES; i++)
+    wasMember[i] = Groups.HasNode (groupIndex, i);
+
+  Groups.Remove (groupIndex);
+
+  for (int i=0; i<MAX_NODES; i++)
+    if (wasMember[i])
+      group_SendMembership (groupIndex, i);
+
+  sprintf (DataString, "S|--|--|GROUP=%s,deleted", name);
+  ToInterface.SendLine (DataString);
+}
+
+//--- group_SendList --------------------------------------
+
+void Relayer::group_SendList ()
+{
+  // One line per group: S|--|--|GROUP=name,Gg,nn.dd,nn.dd,...
+  for (int g=0; g<MAX_GROUPS; g++)
+  {
+    Group *group = Groups.GetGroup (g);
+    if (group == NULL)
+      continue;
+
+    int length = sprintf (DataString, "S|--|--|GROUP=%s,G%d", group->name, g);
+    for (int i=0; i<group->numMembers; i++)
+    {
+      if (group->members[i].deviceIndex < 0)
+        length += sprintf (DataString + length, ",%02d.--", group->members[i].nodeIndex);
+      else
+        length += sprintf (DataString + length, ",%02d.%02d", group->members[i].nodeIndex, group->members[i].deviceIndex);
+    }
+
+    ToInterface.SendLine (DataString);
+  }
+}
+
+//--- group_SendMembership --------------------------------
+
+void Relayer::group_SendMembership (int groupIndex, int nodeIndex)
+{
+  // C|nn|--|JGRP|g,dd,dd,...  or just C|nn|--|JGRP|g to leave the group.
+  // Nodes that aren't registered yet get it when they PING.
+  if (!Peers.IsRegistered (nodeIndex))
+    return;
+
+  char  message[MAX_ESPNOW_LENGTH+1];
+  int   length = sprintf (message, "C|%02d|--|JGRP|%d", nodeIndex, groupIndex);
+
+  if (Groups.GetDeviceList (groupIndex, nodeIndex, message + length + 1) > 0)
+    message[length] = ',';
+
+  if (espnow_SendToNode (nodeIndex, message, strlen (message) + 1, SEND_RELIABLE) != ESP_OK)
+    Peers.RecordSendFailure (nodeIndex);
+}
+
+
+//--- espnow_CheckQueue -----------------------------------
+
+void Relayer::espnow_CheckQueue ()
+{
+  // Process the frames that were queued by ESPNOW_Receiver().
+  // Limit the work per call so serial input is never starved.
+  RxFrame *frame;
+  for (int i=0; i<RX_QUEUE_SLOTS && (frame = ESPNOW_Queue.Peek ()) != NULL; i++)
+  {
+    espnow_ProcessFrame (frame);
+    ESPNOW_Queue.Pop ();
+  }
+
+  // Report any frames that were dropped because the queue was full.
+  // If you see this message then reduce the periodic
+  // data rate for your devices.
+  uint32_t numDropped = ESPNOW_Queue.GetDropped ();
+  if (numDropped != reportedDrops)
+  {
+    sprintf (DataString, "S|--|--|ERROR: ESP-NOW receive queue overflow; %lu messages dropped.", (unsigned long)(numDropped - reportedDrops));
+    ToInterface.SendLine (DataString);
+    reportedDrops = numDropped;
+  }
+}
+
+//--- espnow_ProcessFrame ---------------------------------
+
+void Relayer::espnow_ProcessFrame (RxFrame *frame)
+{
+  // The Relayer can receive both Data and Commands from Nodes and Devices.
+  // Data strings are relayed to the SMAC Interface with "|timestamp" appended.
+  // Command strings are relayed to the target Node and Device, or broadcasted.
+  //
+  //-------------------------
+  //  Data string format:
+  //-------------------------
+  //
+  //   ┌──────────── 1-char packet type ('W' for Widget Data, 'S' for System Data)
+  //   │ ┌────────── 2-char source nodeID (00-99)
+  //   │ │  ┌─────── 2-char source deviceID (00-99)
+  //   │ │  │    ┌── variable length string of values (multiple values are comma delimited)
+  //   │ │  │    │
+  //   d|nn|dd|values
+  //
+  // A bar char '|" and a variable length timestamp field is appended to the string
+  // before being relayed to the SMAC Interface.
+  //
+  // Special Data:
+  // --------------------------------
+  //   PING - A new Node just started and is waiting for a PONG from the Relayer
+  //   HB   - Heartbeat of an idle Node (not relayed, see liveness_Service)
+  //   SLEEPY=ms - The Node sleeps between transmissions (see Mailbox.h)
+  //
+  // A Data String that doesn't fit in one frame arrives in fragments (F|nn|dd|t,mid,index,count|chunk)
+  // and is relayed once it has been put back together (see Reassembler.h).
+  //
+  //-------------------------
+  //  Command string format:
+  //-------------------------
+  //
+  //   ┌───────────────── 1-char packet type ('C' for Command)
+  //   │ ┌─────────────── 2-char target nodeID (00-99), if "--" then the command is broadcasted
+  //   │ │                  (G0-G9 broadcasts the command to a group, see GroupTable.h)
+  //   │ │  ┌──────────── 2-char target deviceID (00-99)
+  //   │ │  │   ┌──────── 4-char command (usually capital letters)
+  //   │ │  │   │     ┌── optional variable length string of parameters (multiple params are comma delimited)
+  //   │ │  │   │     │
+  //   C|nn|dd|cccc|params
+  //
+  // Special Commands:
+  // --------------------------------
+  //   WFCH|n - A Node has requested every ESP-NOW peer to change their WiFi Channel to n (1-13)
+  //            The Relayer schedules the switch for all peers (see channel_Schedule)
+  //
+  //   GPDR   - Peer Directory Request: C|mm|--|GPDR
+  //            A Node wants the MAC address of Node mm so it can send commands to it directly.
+  //            The Relayer answers the requesting Node with C|nn|--|PEER|mm,xx:xx:xx:xx:xx:xx
+  //            (no MAC address if Node mm is not registered).
+  //
+  //   A Command String starting with a lower case 'c' is a copy of a command that a Node
+  //   has already sent directly to another Node.  It is only echoed to the Interface.
+
+
+  const uint8_t  *espnowString = (const uint8_t *) frame->data;
+  int            stringLength  = frame->length;
+
+  // Every frame from a known Node updates its link statistics.
+  // The sender is found by its MAC address, since Command strings carry the target nodeID.
+  int sourceIndex = Peers.FindNode (frame->srcMAC);
+  // Any frame is a keep-alive.
+  if (sourceIndex >= 0)
+  {
+    if (nodeDown[sourceIndex])
+      liveness_Up (sourceIndex, frame->timestamp);
+
+    Peers.RecordReceive (sourceIndex, frame->rssi, frame->noiseFloor, stringLength, frame->timestamp);
+    Rates.RecordRSSI    (frame->srcMAC, frame->rssi);
+
+    // A sleepy Node listens for a moment after each frame it sends
+    if (Mailboxes.IsSleepy (sourceIndex))
+      mailbox_Deliver (sourceIndex);
+  }
+
+  Counters.rxBytes += stringLength;
+
+  // Check minimum string length
+  if (stringLength < MIN_DATA_LENGTH)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Node/Device String too short.");
+    ++Counters.dropInvalid;
+    return;
+  }
+
+  // Get the Node index
+  NodeIndex = 10*((int)(espnowString[2])-48) + ((int)(espnowString[3])-48);
+  if ((NodeIndex < 0 || NodeIndex >= MAX_NODES) && !((char) espnowString[0] == 'C' && IsMulticast (frame->data)))
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid NodeID in Node message.");
+    ++Counters.dropInvalid;
+    return;
+  }
+
+  //===================================
+  // Handle Data strings
+  //===================================
+  if ((char) espnowString[0] == 'W' || (char) espnowString[0] == 'S')
+  {
+    if ((char) espnowString[0] == 'W')
+      ++Counters.rxData;
+    else
+      ++Counters.rxSystem;
+
+    // Handle "PING" from a new Node: S|nn|--|PING or unregistered Node
+    // (a Node is also new if its MAC address is not the one registered for its nodeID)
+    if ((strcmp ((const char *) espnowString + VC_OFFSET, "PING") == 0) || sourceIndex != NodeIndex)
+    {
+      // Haven't heard from this Node yet, so register it as a new peer
+      // Save MAC address in the peer table
+      uint8_t *nodeMAC  = frame->srcMAC;
+      bool     replaced = Peers.IsRegistered (NodeIndex) && memcmp (Peers.GetMAC (NodeIndex), nodeMAC, MAC_SIZE) != 0;
+
+      // The old board's ESP-NOW peer is no longer needed
+      if (replaced && Peers.GetPeer (NodeIndex)->hwPeer)
+        esp_now_del_peer (Peers.GetMAC (NodeIndex));
+
+      // A (re)started Node may have new Devices, names and rates
+      Twins.Invalidate (NodeIndex);
+
+      Peers.Register (NodeIndex, nodeMAC);
+      nodeDown[NodeIndex] = false;
+
+      // It is listening until it says otherwise (SLEEPY=ms)
+      Mailboxes.SetSleepy (NodeIndex, 0);
+      if (sourceIndex != NodeIndex)
+        Peers.RecordReceive (NodeIndex, frame->rssi, frame->noiseFloor, stringLength, frame->timestamp);
+
+      // Send back a "PONG" to the Node
+      // (this makes the new Node an ESP-NOW peer, swapping out the least recently used one if needed)
+      ESPNOW_Result = espnow_SendToNode (NodeIndex, "PONG", COMMAND_SIZE, SEND_RELIABLE);
+      if (ESPNOW_Result != ESP_OK)
+      {
+        Peers.RecordSendFailure (NodeIndex);
+        sprintf (DataString, "S|--|--|ERROR: Unable to send PONG to new Node %d", NodeIndex);
+        ToInterface.SendLine (DataString);
+        return;
+      }
+
+      // Send System Data message to Interface to indicate
+      // that a new Node has connected: S|nn|--|NEWNODE
+      sprintf (DataString, "S|%02d|--|NEWNODE", NodeIndex);
+      ToInterface.SendLine (DataString);
+
+      // Anything held while it was asleep
+      mailbox_Deliver (NodeIndex);
+
+      // A (re)started Node has forgotten its groups
+      for (int g=0; g<MAX_GROUPS; g++)
+        if (Groups.HasNode (g, NodeIndex))
+          group_SendMembership (g, NodeIndex);
+
+      // If a different board took over this nodeID, update the
+      // peer directory of every other Node that may have cached it
+      if (replaced)
+      {
+        int newIndex = NodeIndex;
+        for (int toNode=0; toNode<MAX_NODES; toNode++)
+          if (toNode != newIndex && Peers.IsRegistered (toNode))
+            espnow_SendPeerEntry (toNode, newIndex);
+      }
+    }
+    else if ((char) espnowString[0] == 'S' && strcmp (frame->data + VC_OFFSET, HEARTBEAT_VALUE) == 0)
+    {
+      // An idle Node's keep-alive; the Interface only hears about NODEDOWN and NODEUP
+    }
+    else if ((char) espnowString[0] == 'S' && strncmp (frame->data + VC_OFFSET, "SLEEPY=", 7) == 0)
+    {
+      // The Node sleeps between transmissions and listens for <ms> after each one
+      Mailboxes.SetSleepy (NodeIndex, atoi (frame->data + VC_OFFSET + 7));
+      mailbox_Deliver (NodeIndex);
+
+      ToInterface.SendString (frame->data, stringLength, frame->timestamp);
+      Counters.CountRecord ('S');
+    }
+    else if ((char) espnowString[0] == 'S' && strncmp (frame->data + VC_OFFSET, "ESTOP=", 6) == 0)
+    {
+      // A Node executed an emergency stop
+      estop_CheckAck (NodeIndex, frame);
+    }
+    else
+    {
+      // Keep the twins of the Node and Device up to date
+      Twins.Update (NodeIndex, frame->data, stringLength, frame->timestamp, frame->airtime);
+
+      // Track System Info replies
+      if (discoveryRunning && (char) espnowString[0] == 'S')
+        discovery_CheckReply (NodeIndex, frame->data + VC_OFFSET);
+
+      // Thin out Widget Data streams that have an aggregation policy
+      if ((char) espnowString[0] == 'W')
+      {
+        AggStream *stream = Streams.Find (NodeIndex, ParseID (frame->data + 5));
+        if (stream != NULL)
+        {
+          if (Streams.IsDue (stream, frame->timestamp))
+            stream_Send (stream);
+
+          if (!Streams.Add (stream, frame->data + VC_OFFSET, frame->timestamp))
+            return;
+        }
+      }
+
+      //=====================================================
+      // Append timestamp and relay Data String to Interface
+      //=====================================================
+      ToInterface.SendString (frame->data, stringLength, frame->timestamp);
+      Counters.CountRecord (frame->data[0]);
+    }
+  }
+
+  //===================================
+  // Handle fragments of long Data strings
+  //===================================
+  else if ((char) espnowString[0] == 'F')
+  {
+    // Only from a registered Node (a new Node PINGs first)
+    if (sourceIndex == NodeIndex)
+      fragment_Receive (frame);
+    else
+      ++Counters.dropNoNode;
+  }
+
+  //===================================
+  // Handle Command strings
+  //===================================
+  else if ((char) espnowString[0] == 'C')
+  {
+    ++Counters.rxCommands;
+
+    // Echo command to Interface (for Diagnostic Monitor)
+    ToInterface.SendLine (frame->data);
+
+    // Check data length
+    if (stringLength < MIN_COMMAND_LENGTH)
+    {
+      ToInterface.SendLine ("S|--|--|ERROR: Node/Device Command String too short.");
+      ++Counters.dropInvalid;
+    }
+    else if (strncmp ((const char *) espnowString + VC_OFFSET, "GPDR", COMMAND_SIZE) == 0)
+    {
+      // Peer directory request; answer the requesting Node
+      if (sourceIndex >= 0)
+        espnow_SendPeerEntry (sourceIndex, NodeIndex);
+    }
+    else if (strncmp ((const char *) espnowString + VC_OFFSET, "WFCH", COMMAND_SIZE) == 0)
+    {
+      // Move the whole SMAC network to the requested channel
+      if (stringLength > MIN_COMMAND_LENGTH + 1)
+        channel_Schedule ((const char *) espnowString + MIN_COMMAND_LENGTH + 1);
+    }
+    else if (IsMulticast (frame->data))
+    {
+      // A Node's own broadcast has already reached every Node
+      if (!frame->broadcast)
+        espnow_SendMulticast (frame->data, stringLength);
+    }
+    else
+    {
+      // Check if target Node exists
+      if (Peers.IsRegistered (NodeIndex))
+      {
+        //=====================================================
+        // Relay Command String to target Node/Device
+        //=====================================================
+        if (mailbox_Put (NodeIndex, frame->data, stringLength, false))
+        {
+          // A sleepy Node gets it when it listens
+          ++Counters.relayedCommands;
+        }
+        else if (espnow_SendToNode (NodeIndex, espnowString, stringLength, SEND_RELIABLE) != ESP_OK)
+        {
+          Peers.RecordSendFailure (NodeIndex);
+          ToInterface.SendLine ("S|--|--|ERROR: Unable to relay command; ESP-NOW send queue is full.");
+        }
+        else
+          ++Counters.relayedCommands;
+      }
+      else
+      {
+        ToInterface.SendLine ("S|--|--|ERROR: Unable to relay command; Node does not exist.");
+        ++Counters.dropNoNode;
+      }
+    }
+  }
+
+  //===================================
+  // Handle copies of direct commands
+  //===================================
+  else if ((char) espnowString[0] == 'c')
+  {
+    // Already delivered Node-to-Node, so only echo it to
+    // the Interface (for Diagnostic Monitor) as a Command
+    ++Counters.rxCommands;
+    frame->data[0] = 'C';
+    ToInterface.SendLine (frame->data);
+  }
+
+  else
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Unknown ESP-NOW Message string.");
+    ++Counters.dropInvalid;
+  }
+}
+
+//--- fragment_Receive ------------------------------------
+
+void Relayer::fragment_Receive (RxFrame *frame)
+{
+  // F|nn|dd|t,mid,index,count|chunk
+  Reassembly     *message;
+  FragmentResult  result = Fragments.Add (NodeIndex, frame->data, frame->length, frame->timestamp, &message);
+
+  switch (result)
+  {
+    case FRAGMENT_INVALID:
+      ToInterface.SendLine ("S|--|--|ERROR: Invalid fragment in Node message.");
+      ++Counters.dropInvalid;
+      break;
+
+    case FRAGMENT_NO_SLOT:
+      // The Node sends it again when the FACK doesn't come
+      break;
+
+    case FRAGMENT_ADDED:
+      break;
+
+    case FRAGMENT_MISSING:
+      fragment_SendAck (NodeIndex, message, false);
+      break;
+
+    case FRAGMENT_COMPLETE:
+      if (message->text[0] == 'W')
+        ++Counters.rxData;
+      else
+        ++Counters.rxSystem;
+
+      Twins.Update (NodeIndex, message->text, message->length, message->firstTime);
+
+      //=====================================================
+      // Append timestamp and relay Data String to Interface
+      //=====================================================
+      // (with the capture time of its first fragment)
+      if (ToInterface.SendLong (message->text, message->length, message->firstTime, &message->sending))
+        Counters.CountRecord (message->text[0]);
+
+      fragment_SendAck (NodeIndex, message, true);
+      break;
+
+    case FRAGMENT_REPEAT:
+      // The Node missed the last FACK
+      fragment_SendAck (NodeIndex, message, true);
+      break;
+  }
+}
+
+//--- fragment_SendAck ------------------------------------
+
+void Relayer::fragment_SendAck (int nodeIndex, Reassembly *message, bool complete)
+{
+  // C|nn|--|FACK|mid,bitmap
+  // The last FACK must get through; the Node sends the missing fragments again if a partial one is lost
+  char ack[MIN_COMMAND_LENGTH + 12];
+  int  length = sprintf (ack, "C|%02d|--|FACK|%u,%X", nodeIndex, (unsigned int) message->messageID, (unsigned int) message->received);
+
+  if (espnow_SendToNode (nodeIndex, ack, length + 1, complete ? SEND_RELIABLE : SEND_BEST_EFFORT) != ESP_OK)
+    Peers.RecordSendFailure (nodeIndex);
+}
+
+//--- channel_StartSurvey ---------------------------------
+
+void Relayer::channel_StartSurvey ()
+{
+  // C|--|--|SURV[|dwell][,AUTO]
+  //
+  // Listens to each channel 1-MAX_CHANNEL for <dwell> milliseconds (SURVEY_DWELL if not given)
+  // and adds up the airtime of all other WiFi traffic heard there.  The Relayer goes back to
+  // the home channel for SURVEY_HOME_TIME between channels so the SMAC network keeps running;
+  // messages that are sent while it is away are retried.  When done:
+  //
+  //   S|--|--|SURVEY=ch,frames,busy%   (one line per channel)
+  //   S|--|--|SURVEY=DONE,bestChannel,homeChannel
+  //
+  // With AUTO, the whole network is then switched to the best channel.
+  if (surveyChannel != 0 || switchChannel != 0)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: A channel survey or switch is already running.");
+    return;
+  }
+
+  const char  *params = commandString + MIN_COMMAND_LENGTH + 1;
+  long         dwell  = (commandLength > MIN_COMMAND_LENGTH) ? atol (params) : 0;
+
+  if (dwell <= 0) dwell = SURVEY_DWELL;
+  if (dwell > SURVEY_MAX_DWELL) dwell = SURVEY_MAX_DWELL;
+
+  surveyAutoSwitch = (commandLength > MIN_COMMAND_LENGTH && strstr (params, "AUTO") != NULL);
+  surveyDwell      = (int64_t) dwell * 1000LL;
+
+  for (int i=0; i<=MAX_CHANNEL; i++)
+  {
+    SurveyFrames[i]  = 0;
+    SurveyAirtime[i] = 0;
+  }
+
+  esp_wifi_set_promiscuous_rx_cb (SurveySniffer);
+  if (esp_wifi_set_promiscuous (true) != ESP_OK)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Unable to start the channel survey.");
+    return;
+  }
+
+  atRendezvous   = false;
+  surveyAtHome   = false;
+  surveyChannel  = 1;
+  surveyStepTime = esp_timer_get_time ();
+  SampledChannel = surveyChannel;
+  esp_wifi_set_channel (surveyChannel, WIFI_SECOND_CHAN_NONE);
+}
+
+//--- channel_FinishSurvey --------------------------------
+
+void Relayer::channel_FinishSurvey (bool cancelled)
+{
+  SampledChannel = 0;
+  surveyChannel  = 0;
+  esp_wifi_set_promiscuous (false);
+  esp_wifi_set_channel (homeChannel, WIFI_SECOND_CHAN_NONE);
+
+  if (cancelled)
+  {
+    ToInterface.SendLine ("S|--|--|SURVEY=CANCELLED");
+    return;
+  }
+
+  int bestChannel = homeChannel;
+  for (int channel=1; channel<=MAX_CHANNEL; channel++)
+  {
+    sprintf (DataString, "S|--|--|SURVEY=%d,%lu,%.1f", channel, (unsigned long) SurveyFrames[channel], 100.0f * (float) SurveyAirtime[channel] / (float) surveyDwell);
+    ToInterface.SendLine (DataString);
+
+    if (SurveyAirtime[channel] < SurveyAirtime[bestChannel])
+      bestChannel = channel;
+  }
+
+  // Only move if the best channel is clearly less busy than the home channel
+  if ((uint64_t) SurveyAirtime[bestChannel] * 100 > (uint64_t) SurveyAirtime[homeChannel] * (100 - SURVEY_MARGIN))
+    bestChannel = homeChannel;
+
+  sprintf (DataString, "S|--|--|SURVEY=DONE,%d,%d", bestChannel, homeChannel);
+  ToInterface.SendLine (DataString);
+
+  if (surveyAutoSwitch && bestChannel != homeChannel)
+  {
+    char params[4];
+    sprintf (params, "%d", bestChannel);
+    channel_Schedule (params);
+  }
+}
+
+//--- channel_Schedule ------------------------------------
+
+void Relayer::channel_Schedule (const char *params)
+{
+  // ch[,ms]  -->  S|--|--|WFCH=ch,ms
+  //
+  // Every peer switches to channel ch in ms milliseconds (CHANNEL_SWITCH_DELAY if not given).
+  // Until then the switch is announced to all Nodes every CHANNEL_ANNOUNCE milliseconds:
+  //
+  //   C|--|--|WFCH|ch,msLeft
+  //
+  // so a Node only has to hear one of the announcements to switch at the same time as the others.
+  // For RENDEZVOUS_DURATION after the switch, the Relayer also visits RENDEZVOUS_CHANNEL now and
+  // then and broadcasts C|--|--|WFCH|ch,0 there for Nodes that missed all of them.
+  int          newChannel = atoi (params);
+  const char  *delay      = strchr (params, ',');
+  long         delayTime  = (delay == NULL) ? CHANNEL_SWITCH_DELAY : atol (delay + 1);
+
+  if (newChannel < 1 || newChannel > MAX_CHANNEL)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid WiFi Channel; use 1-13.");
+    return;
+  }
+
+  if (delayTime < CHANNEL_MIN_DELAY) delayTime = CHANNEL_MIN_DELAY;
+  if (delayTime > CHANNEL_MAX_DELAY) delayTime = CHANNEL_MAX_DELAY;
+
+  // Announcements go out on the home channel
+  if (surveyChannel != 0)
+    channel_FinishSurvey (true);
+
+  if (atRendezvous)
+  {
+    atRendezvous = false;
+    esp_wifi_set_channel (homeChannel, WIFI_SECOND_CHAN_NONE);
+  }
+
+  int64_t now = esp_timer_get_time ();
+
+  switchChannel = (uint8_t) newChannel;
+  switchTime    = now + (int64_t) delayTime * 1000LL;
+  channel_Announce (now);
+
+  sprintf (DataString, "S|--|--|WFCH=%d,%ld", newChannel, delayTime);
+  ToInterface.SendLine (DataString);
+}
+
+//--- channel_Announce ------------------------------------
+
+void Relayer::channel_Announce (int64_t now)
+{
+  // C|--|--|WFCH|ch,msLeft
+  char  message[MIN_COMMAND_LENGTH+16];
+  long  timeLeft = (long)((switchTime - now) / 1000LL);
+
+  int length = sprintf (message, "C|--|--|WFCH|%d,%ld", switchChannel, (timeLeft > 0) ? timeLeft : 0L) + 1;
+  Outbox.Send (NULL, message, length, SEND_BEST_EFFORT);
+
+  lastAnnounce = now;
+}
+
+//--- channel_Service -------------------------------------
+
+void Relayer::channel_Service (int64_t now)
+{
+  //--- Scheduled switch ---
+  if (switchChannel != 0)
+  {
+    if (now >= switchTime)
+    {
+      homeChannel   = switchChannel;
+      switchChannel = 0;
+      esp_wifi_set_channel (homeChannel, WIFI_SECOND_CHAN_NONE);
+
+      // Nodes report S|nn|--|CHANNEL=ch from the new channel as they follow
+      rendezvousUntil = (homeChannel == RENDEZVOUS_CHANNEL) ? 0 : now + RENDEZVOUS_DURATION * 1000LL;
+      lastRendezvous  = now;
+
+      sprintf (DataString, "S|--|--|CHANNEL=%d", homeChannel);
+      ToInterface.SendLine (DataString);
+    }
+    else if (now - lastAnnounce >= CHANNEL_ANNOUNCE * 1000LL)
+      channel_Announce (now);
+
+    return;
+  }
+
+  //--- Survey, one channel at a time with a visit home in between ---
+  if (surveyChannel != 0)
+  {
+    if (now - surveyStepTime < (surveyAtHome ? SURVEY_HOME_TIME * 1000LL : surveyDwell))
+      return;
+
+    surveyStepTime = now;
+
+    if (!surveyAtHome)
+    {
+      SampledChannel = 0;
+      if (surveyChannel >= MAX_CHANNEL)
+      {
+        channel_FinishSurvey (false);
+        return;
+      }
+
+      surveyAtHome = true;
+      esp_wifi_set_channel (homeChannel, WIFI_SECOND_CHAN_NONE);
+    }
+    else
+    {
+      surveyAtHome   = false;
+      SampledChannel = ++surveyChannel;
+      esp_wifi_set_channel (surveyChannel, WIFI_SECOND_CHAN_NONE);
+    }
+
+    return;
+  }
+
+  //--- Visits to the rendezvous channel after a switch ---
+  if (atRendezvous && now - lastRendezvous >= RENDEZVOUS_DWELL * 1000LL)
+  {
+    atRendezvous = false;
+    esp_wifi_set_channel (homeChannel, WIFI_SECOND_CHAN_NONE);
+  }
+  else if (!atRendezvous && now < rendezvousUntil && now - lastRendezvous >= RENDEZVOUS_PERIOD * 1000LL)
+  {
+    atRendezvous   = true;
+    lastRendezvous = now;
+    esp_wifi_set_channel (RENDEZVOUS_CHANNEL, WIFI_SECOND_CHAN_NONE);
+
+    char  message[MIN_COMMAND_LENGTH+8];
+    int   length = sprintf (message, "C|--|--|WFCH|%d,0", homeChannel) + 1;
+    Outbox.Send (NULL, message, length, SEND_BEST_EFFORT);
+  }
+}
+
+//--- discovery_Start -------------------------------------
+
+void Relayer::discovery_Start ()
+{
+  // System Info (SYSI) is a paced job: only DISCOVERY_WINDOW Nodes are asked
+  // for their Node and Device info at a time.  The next Node is asked when
+  // one has sent all its info (NOINFO and one DEINFO per Device) or has
+  // not replied for DISCOVERY_TIMEOUT.  When all Nodes are done:
+  //
+  //   S|--|--|SYSI=DONE,nodesFound,nodesTimedOut,milliseconds,nodesFromTwins
+  //
+  // Nodes with complete twins are answered right away from the twins
+  // (see TwinTable.h), unless the Interface asks for FRESH info.
+  bool fresh = (commandLength > MIN_COMMAND_LENGTH && strcmp (commandString + MIN_COMMAND_LENGTH + 1, "FRESH") == 0);
+
+  discoveryActive   = 0;
+  discoveryFound    = 0;
+  discoveryCached   = 0;
+  discoveryTimeouts = 0;
+  discoveryStart    = esp_timer_get_time ();
+  discoveryRunning  = true;
+
+  for (int nodeIndex=0; nodeIndex<MAX_NODES; nodeIndex++)
+  {
+    discoveryNodes[nodeIndex].state = DISCOVERY_IDLE;
+
+    if (!Peers.IsRegistered (nodeIndex))
+      continue;
+
+    if (!fresh && Twins.IsComplete (nodeIndex))
+    {
+      twin_SendInfo (nodeIndex);
+      ++discoveryFound;
+      ++discoveryCached;
+    }
+    else
+      discoveryNodes[nodeIndex].state = DISCOVERY_PENDING;
+  }
+
+  discovery_Service ();
+}
+
+//--- discovery_Service -----------------------------------
+
+void Relayer::discovery_Service ()
+{
+  int64_t now = esp_timer_get_time ();
+
+  // Give up on Nodes that stopped replying
+  for (int nodeIndex=0; nodeIndex<MAX_NODES; nodeIndex++)
+    if (discoveryNodes[nodeIndex].state == DISCOVERY_ACTIVE && now - discoveryNodes[nodeIndex].lastReplyTime > DISCOVERY_TIMEOUT)
+      discovery_Finish (nodeIndex, true);
+
+  // Ask the next Nodes while there is room in the window
+  bool pending = false;
+  for (int nodeIndex=0; nodeIndex<MAX_NODES; nodeIndex++)
+  {
+    DiscoveryNode *node = &discoveryNodes[nodeIndex];
+    if (node->state != DISCOVERY_PENDING)
+      continue;
+
+    if (discoveryActive >= DISCOVERY_WINDOW)
+    {
+      pending = true;
+      break;
+    }
+
+    node->state         = DISCOVERY_ACTIVE;
+    node->numDevices    = -1;
+    node->devicesFound  = 0;
+    node->lastReplyTime = now;
+    ++discoveryActive;
+
+    // (commandString may hold a partial Interface command, so use a local buffer)
+    char  request[MIN_COMMAND_LENGTH+1];
+
+    sprintf (request, "C|%02d|--|GNOI", nodeIndex);  // Get Node Info
+    if (espnow_SendToNode (nodeIndex, request, MIN_COMMAND_LENGTH + 1, SEND_RELIABLE) != ESP_OK)
+      Peers.RecordSendFailure (nodeIndex);
+
+    sprintf (request, "C|%02d|--|GDEI", nodeIndex);  // Get Device Info
+    if (espnow_SendToNode (nodeIndex, request, MIN_COMMAND_LENGTH + 1, SEND_RELIABLE) != ESP_OK)
+      Peers.RecordSendFailure (nodeIndex);
+  }
+
+  // All done?
+  if (!pending && discoveryActive == 0)
+  {
+    discoveryRunning = false;
+
+    sprintf (DataString, "S|--|--|SYSI=DONE,%d,%d,%lu,%d", discoveryFound, discoveryTimeouts, (unsigned long)((now - discoveryStart) / 1000), discoveryCached);
+    ToInterface.SendLine (DataString);
+  }
+}
+
+//--- discovery_CheckReply --------------------------------
+
+void Relayer::discovery_CheckReply (int nodeIndex, const char *values)
+{
+  DiscoveryNode *node = &discoveryNodes[nodeIndex];
+  if (node->state != DISCOVERY_ACTIVE)
+    return;
+
+  // NOINFO=name,version,macAddress,numDevices
+  if (strncmp (values, "NOINFO=", 7) == 0)
+  {
+    const char *lastComma = strrchr (values, ',');
+    node->numDevices = (lastComma == NULL) ? 0 : atoi (lastComma + 1);
+  }
+  // DEINFO=name,version,ipEnabled,ppEnabled,rate
+  else if (strncmp (values, "DEINFO=", 7) == 0)
+    node->devicesFound++;
+  else
+    return;
+
+  node->lastReplyTime = esp_timer_get_time ();
+
+  if (node->numDevices >= 0 && node->devicesFound >= node->numDevices)
+    discovery_Finish (nodeIndex, false);
+}
+
+//--- discovery_Finish ------------------------------------
+
+void Relayer::discovery_Finish (int nodeIndex, bool timedOut)
+{
+  discoveryNodes[nodeIndex].state = DISCOVERY_IDLE;
+  --discoveryActive;
+
+  if (timedOut)
+    ++discoveryTimeouts;
+  else
+    ++discoveryFound;
+}
+
+//--- liveness_Set ----------------------------------------
+
+void Relayer::liveness_Set ()
+{
+  // C|--|--|SLIV|nn,ms  -->  S|--|--|LIVENESS=nn,ms
+  //
+  // A Node is reported down after <ms> milliseconds without a frame from it:
+  //
+  //   S|nn|--|NODEDOWN=msSilent   and, at its next frame,   S|nn|--|NODEUP=msSilent
+  //
+  // "--" sets the default for all Nodes.  Idle Nodes send a heartbeat every MAX_SILENT_DURATION,
+  // so <ms> should be at least LIVENESS_HEARTBEATS times longer than that.
+  const char  *params   = commandString + MIN_COMMAND_LENGTH + 1;
+  bool         allNodes = (params[0] == '-' && params[1] == '-');
+  int          nodeIndex;
+  long         ms;
+
+  if (commandLength < MIN_COMMAND_LENGTH + 5 || params[2] != ',')
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid SLIV; use nn,ms");
+    return;
+  }
+
+  nodeIndex = ParseID (params);
+  ms        = atol (params + 3);
+
+  if (!allNodes && nodeIndex < 0)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid nodeID for SLIV.");
+    return;
+  }
+
+  if (ms < LIVENESS_MIN_TIME) ms = LIVENESS_MIN_TIME;
+  if (ms > LIVENESS_MAX_TIME) ms = LIVENESS_MAX_TIME;
+
+  if (allNodes)
+  {
+    livenessDefault = (uint32_t) ms;
+    memset (downTime, 0, sizeof(downTime));
+  }
+  else
+    downTime[nodeIndex] = (uint32_t) ms;
+
+  sprintf (DataString, "S|--|--|LIVENESS=%.2s,%ld", params, ms);
+  ToInterface.SendLine (DataString);
+}
+
+//--- liveness_SendList -----------------------------------
+
+void Relayer::liveness_SendList ()
+{
+  // One line per registered Node: S|nn|--|LIVE=UP or DOWN,msSinceLastSeen,ms
+  int64_t now = esp_timer_get_time ();
+
+  for (int i=0; i<MAX_NODES; i++)
+  {
+    if (!Peers.IsRegistered (i))
+      continue;
+
+    sprintf (DataString, "S|%02d|--|LIVE=%s,%lu,%lu", i, nodeDown[i] ? "DOWN" : "UP",
+             (unsigned long)((now - Peers.GetPeer (i)->lastSeen) / 1000), (unsigned long)(downTime[i] ? downTime[i] : livenessDefault));
+    ToInterface.SendLine (DataString);
+  }
+}
+
+//--- liveness_Service ------------------------------------
+
+void Relayer::liveness_Service (int64_t now)
+{
+  if (now - lastLivenessCheck < LIVENESS_CHECK_TIME * 1000LL)
+    return;
+
+  lastLivenessCheck = now;
+
+  for (int i=0; i<MAX_NODES; i++)
+  {
+    if (nodeDown[i] || !Peers.IsRegistered (i))
+      continue;
+
+    int64_t silent = now - Peers.GetPeer (i)->lastSeen;
+    if (silent > (downTime[i] ? downTime[i] : livenessDefault) * 1000LL)
+    {
+      nodeDown[i] = true;
+
+      sprintf (DataString, "S|%02d|--|NODEDOWN=%lu", i, (unsigned long)(silent / 1000));
+      ToInterface.SendLine (DataString);
+    }
+  }
+}
+
+//--- liveness_Up -----------------------------------------
+
+void Relayer::liveness_Up (int nodeIndex, int64_t timestamp)
+{
+  // First frame from a Node that was reported down
+  nodeDown[nodeIndex] = false;
+
+  sprintf (DataString, "S|%02d|--|NODEUP=%lu", nodeIndex, (unsigned long)((timestamp - Peers.GetPeer (nodeIndex)->lastSeen) / 1000));
+  ToInterface.SendLine (DataString);
+}
+
+//--- throttle_Set ---------------------------------------
+
+void Relayer::throttle_Set ()
+{
+  // C|--|--|STHR|1 or 0  -->  S|--|--|THROTTLE=...  (see throttle_Report)
+  //
+  // Turning congestion control off lets the Nodes run at their full rates again.
+  if (commandLength > MIN_COMMAND_LENGTH)
+    throttleEnabled = (atoi (commandString + MIN_COMMAND_LENGTH + 1) != 0);
+
+  if (!throttleEnabled && throttleRate < 1.0f)
+  {
+    throttleRate = 1.0f;
+    throttle_Broadcast (esp_timer_get_time ());
+  }
+
+  throttle_Report ();
+}
+
+//--- throttle_Report -------------------------------------
+
+void Relayer::throttle_Report ()
+{
+  // S|--|--|THROTTLE=factor,rxDropped,lineDropped,sendLoss%,gaps  (counts of the last check)
+  //
+  // Sent whenever the factor changes; 1.00 means the Nodes run at their full rates.
+  int lossPercent = (throttleDelta.sent > 0) ? (int)(100 * throttleDelta.failed / throttleDelta.sent) : 0;
+
+  sprintf (DataString, "S|--|--|THROTTLE=%.2f,%lu,%lu,%d,%lu%s", 1.0f / throttleRate,
+           (unsigned long) throttleDelta.rxDropped, (unsigned long) throttleDelta.lineDropped,
+           lossPercent, (unsigned long) throttleDelta.gaps, throttleEnabled ? "" : ",OFF");
+  ToInterface.SendLine (DataString);
+}
+
+//--- throttle_Service ------------------------------------
+
+void Relayer::throttle_Service (int64_t now)
+{
+  // Additive increase, multiplicative decrease of the share of their rates the Nodes may use:
+  // it is halved by every check that saw congestion and raised by THROTTLE_STEP by every one that did not.
+  // Congestion is any frame or line dropped, too many failed sends or a long Data String with missing fragments.
+  if (now - lastThrottleCheck < THROTTLE_CHECK_TIME * 1000LL)
+    return;
+
+  lastThrottleCheck = now;
+
+  CongestionSample sample;
+  sample.rxDropped   = ESPNOW_Queue.GetDropped ();
+  sample.lineDropped = ToInterface.GetDropped ();
+  sample.sent        = Outbox.GetSent ();
+  sample.failed      = Outbox.GetRetries () + Outbox.GetLost ();
+  sample.gaps        = Fragments.GetTimeouts ();
+
+  throttleDelta.rxDropped   = sample.rxDropped   - throttleLast.rxDropped;
+  throttleDelta.lineDropped = sample.lineDropped - throttleLast.lineDropped;
+  throttleDelta.sent        = sample.sent        - throttleLast.sent;
+  throttleDelta.failed      = sample.failed      - throttleLast.failed;
+  throttleDelta.gaps        = sample.gaps        - throttleLast.gaps;
+  throttleLast = sample;
+
+  if (!throttleEnabled)
+    return;
+
+  bool congested = throttleDelta.rxDropped > 0 || throttleDelta.lineDropped > 0 || throttleDelta.gaps > 0 ||
+                   (throttleDelta.sent >= THROTTLE_MIN_SENDS && 100 * throttleDelta.failed > THROTTLE_LOSS_PERCENT * throttleDelta.sent);
+
+  float newRate = congested ? throttleRate / 2 : throttleRate + THROTTLE_STEP;
+  if (newRate < 1.0f / THROTTLE_MAX_FACTOR) newRate = 1.0f / THROTTLE_MAX_FACTOR;
+  if (newRate > 1.0f)                       newRate = 1.0f;
+
+  if (newRate != throttleRate)
+  {
+    throttleRate = newRate;
+    throttle_Broadcast (now);
+    throttle_Report ();
+  }
+  else if (throttleRate < 1.0f && now - lastThrottleSend >= THROTTLE_REFRESH_TIME * 1000LL)
+    throttle_Broadcast (now);  // Keep the Nodes throttled
+}
+
+//--- throttle_Broadcast ----------------------------------
+
+void Relayer::throttle_Broadcast (int64_t now)
+{
+  // C|--|--|THRO|factor to all Nodes
+  char message[MIN_COMMAND_LENGTH+8];
+  int  length = sprintf (message, "C|--|--|THRO|%.2f", 1.0f / throttleRate);
+
+  Outbox.Send (NULL, message, length + 1, SEND_BEST_EFFORT);
+  lastThrottleSend = now;
+}
+
+//--- mailbox_Put ----------------------------------------
+
+bool Relayer::mailbox_Put (int nodeIndex, const char *text, int length, bool latest)
+{
+  // Holds a Command String for Node nn if it is sleepy; returns false if it can be sent now
+  if (!Mailboxes.IsSleepy (nodeIndex))
+    return false;
+
+  Mail        dropped;
+  MailResult  result = Mailboxes.Put (nodeIndex, text, strnlen (text, length), latest, esp_timer_get_time (), &dropped);
+
+  if (result == MAIL_NO_SLOT)
+    sprintf (DataString, "S|%02d|%.2s|ERROR: Mailbox full; dropped %.200s", nodeIndex, text + 5, text);
+  else
+  {
+    if (result == MAIL_DROPPED)
+    {
+      sprintf (DataString, "S|%02d|%.2s|ERROR: Mailbox full; dropped %.200s", nodeIndex, dropped.text + 5, dropped.text);
+      ToInterface.SendLine (DataString);
+    }
+
+    sprintf (DataString, "S|%02d|%.2s|MAILBOX=%d", nodeIndex, text + 5, Mailboxes.GetCount (nodeIndex));
+  }
+
+  ToInterface.SendLine (DataString);
+  return true;
+}
+
+//--- mailbox_Deliver -------------------------------------
+
+void Relayer::mailbox_Deliver (int nodeIndex)
+{
+  // Called right after a frame from the Node, while it listens
+  Mail *mail;
+
+  while ((mail = Mailboxes.Next (nodeIndex)) != NULL)
+  {
+    // If the send queue is full, the rest wait for the Node's next frame
+    if (espnow_SendToNode (nodeIndex, mail->text, mail->length + 1, SEND_RELIABLE, mail->latest) != ESP_OK)
+      return;
+
+    Mailboxes.Delivered (mail);
+  }
+}
+
+//--- mailbox_Service -------------------------------------
+
+void Relayer::mailbox_Service (int64_t now)
+{
+  Mail *mail;
+
+  while ((mail = Mailboxes.Expired (now)) != NULL)
+  {
+    sprintf (DataString, "S|%02d|%.2s|ERROR: Command expired in mailbox: %.200s", mail->nodeIndex, mail->text + 5, mail->text);
+    ToInterface.SendLine (DataString);
+
+    Mailboxes.Remove (mail);
+  }
+}
+
+//--- mailbox_Set -----------------------------------------
+
+void Relayer::mailbox_Set ()
+{
+  // C|--|--|SMBX|limit,expiryMs  -->  S|--|--|MAILBOX=...  (see mailbox_SendList)
+  const char *params = commandString + MIN_COMMAND_LENGTH + 1;
+  const char *expiry = strchr (params, ',');
+
+  if (commandLength <= MIN_COMMAND_LENGTH || expiry == NULL)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid SMBX; use limit,expiryMs");
+    return;
+  }
+
+  Mailboxes.SetLimits (atoi (params), atol (expiry + 1));
+  mailbox_SendList ();
+}
+
+//--- mailbox_SendList ------------------------------------
+
+void Relayer::mailbox_SendList ()
+{
+  // S|nn|--|SLEEPY=ms,waiting for each sleepy Node, then
+  // S|--|--|MAILBOX=limit,expiryMs,waiting,delivered,expired,dropped
+  for (int i=0; i<MAX_NODES; i++)
+  {
+    if (Mailboxes.IsSleepy (i) || Mailboxes.GetCount (i) > 0)
+    {
+      sprintf (DataString, "S|%02d|--|SLEEPY=%d,%d", i, Mailboxes.GetListen (i), Mailboxes.GetCount (i));
+      ToInterface.SendLine (DataString);
+    }
+  }
+
+  sprintf (DataString, "S|--|--|MAILBOX=%d,%ld,%d,%lu,%lu,%lu", Mailboxes.GetLimit (), Mailboxes.GetExpiry (), Mailboxes.GetCount (),
+           (unsigned long) Mailboxes.GetDelivered (), (unsigned long) Mailboxes.GetExpired (), (unsigned long) Mailboxes.GetDropped ());
+  ToInterface.SendLine (DataString);
+}
+
+//--- twin_SendInfo ---------------------------------------
+
+void Relayer::twin_SendInfo (int nodeIndex)
+{
+  // The same NOINFO and DEINFO Data Strings the Node would send, with their original capture times
+  NodeTwin *node = Twins.GetNode (nodeIndex);
+
+  int length = sprintf (DataString, "S|%02d|--|NOINFO=%s,%s,%s,%d", nodeIndex, node->name, node->version, node->mac, node->numDevices);
+  ToInterface.SendString (DataString, length, node->infoTime);
+
+  for (int d=0; d<node->numDevices; d++)
+  {
+    DeviceTwin *device = node->devices[d];
+
+    length = sprintf (DataString, "S|%02d|%02d|DEINFO=%s,%s,%c,%c,%lu", nodeIndex, d, device->name, device->version,
+                      device->ipEnabled ? 'Y' : 'N', device->ppEnabled ? 'Y' : 'N', device->rate);
+    ToInterface.SendString (DataString, length, device->infoTime);
+  }
+}
+
+//--- twin_SendLastValue ----------------------------------
+
+void Relayer::twin_SendLastValue ()
+{
+  // C|nn|dd|GLVA  -->  W|nn|dd|values|timestamp  or  S|nn|dd|LAST=NONE
+  int         nodeIndex   = ParseID (commandString + 2);
+  int         deviceIndex = ParseID (commandString + 5);
+  DeviceTwin *device      = Twins.GetDevice (nodeIndex, deviceIndex);
+
+  if (nodeIndex < 0 || deviceIndex < 0)
+    ToInterface.SendLine ("S|--|--|ERROR: GLVA needs a nodeID and deviceID.");
+  else if (device == NULL || device->valueLength == 0)
+  {
+    sprintf (DataString, "S|%02d|%02d|LAST=NONE", nodeIndex, deviceIndex);
+    ToInterface.SendLine (DataString);
+  }
+  else
+  {
+    int length = sprintf (DataString, "W|%02d|%02d|", nodeIndex, deviceIndex);
+    memcpy (DataString + length, device->value, device->valueLength + 1);
+    ToInterface.SendString (DataString, length + device->valueLength, device->valueTime);
+  }
+}
+
+//--- budget_Set -----------------------------------------
+
+void Relayer::budget_Set ()
+{
+  // C|--|--|SBUD|air%,serial%[,CLAMP|REJECT|OFF]  -->  S|--|--|BUDGET=...  (see budget_SendReport)
+  const char  *params = commandString + MIN_COMMAND_LENGTH + 1;
+  const char  *serial = strchr (params, ',');
+  BudgetMode   mode   = Budget.GetMode ();
+
+  if (commandLength <= MIN_COMMAND_LENGTH || serial == NULL)
+  {
+    ToInterface.SendLine ("S|--|--|ERROR: Invalid SBUD; use air%,serial%[,CLAMP|REJECT|OFF]");
+    return;
+  }
+
+  const char *modeName = strchr (serial + 1, ',');
+  if (modeName != NULL)
+  {
+    if      (strcmp (modeName + 1, "CLAMP")  == 0) mode = BUDGET_CLAMP;
+    else if (strcmp (modeName + 1, "REJECT") == 0) mode = BUDGET_REJECT;
+    else if (strcmp (modeName + 1, "OFF")    == 0) mode = BUDGET_OFF;
+    else
+    {
+      ToInterface.SendLine ("S|--|--|ERROR: Invalid SBUD mode; use CLAMP, REJECT or OFF");
+      return;
+    }
+  }
+
+  Budget.SetLimits (atoi (params), atoi (serial + 1), mode);
+  budget_SendReport ();
+}
+
+//--- budget_SendReport -----------------------------------
+
+void Relayer::budget_SendReport ()
+{
+  // C|--|--|GBUD  -->  S|--|--|BUDGET=airUsed%,airLeft%,serialUsed%,serialLeft%,mode,clamped,rejected
+  //
+  // Used is the load of all periodic Widget Data, left is the headroom to the limits set with SBUD.
+  BudgetLoad load;
+  Budget.GetLoad (&load);
+
+  float airUsed    = load.airtime * 100.0f;
+  float serialUsed = load.serial  * 100.0f;
+
+  sprintf (DataString, "S|--|--|BUDGET=%.1f,%.1f,%.1f,%.1f,%s,%lu,%lu",
+           airUsed,    Budget.GetAirLimit ()    - airUsed,
+           serialUsed, Budget.GetSerialLimit () - serialUsed,
+           LinkBudget::GetModeName (Budget.GetMode ()),
+           (unsigned long) Budget.numClamped, (unsigned long) Budget.numRejected);
+  ToInterface.SendLine (DataString);
+}
+
+//--- budget_CheckRate ------------------------------------
+
+bool Relayer::budget_CheckRate ()
+{
+  // C|nn|dd|SRAT|rate
+  //
+  // Returns true if <commandString> may be relayed, lowering its rate first if the budget is set to CLAMP:
+  //   S|nn|dd|BUDGET=CLAMPED,requested,allowed
+  // or false if the rate does not fit:
+  //   S|nn|dd|ERROR: SRAT rejected; link budget allows <n> per hour
+  if (Budget.GetMode () == BUDGET_OFF || commandLength <= MIN_COMMAND_LENGTH)
+    return true;
+
+  int            nodeIndex   = ParseID (commandString + 2);
+  int            deviceIndex = ParseID (commandString + 5);
+  double         requested   = atof (commandString + MIN_COMMAND_LENGTH + 1);
+  unsigned long  allowed;
+
+  if (nodeIndex < 0 || deviceIndex < 0)
+    return true;
+
+  allowed = Budget.MaxRate (nodeIndex, deviceIndex);
+  if (requested <= allowed)
+    return true;
+
+  // Devices run at least once per hour, so there is nothing to clamp to
+  if (Budget.GetMode () == BUDGET_REJECT || allowed < 1)
+  {
+    ++Budget.numRejected;
+    sprintf (DataString, "S|%02d|%02d|ERROR: SRAT rejected; link budget allows %lu per hour", nodeIndex, deviceIndex, allowed);
+    ToInterface.SendLine (DataString);
+    return false;
+  }
+
+  ++Budget.numClamped;
+  commandLength = MIN_COMMAND_LENGTH + 1 + sprintf (commandString + MIN_COMMAND_LENGTH + 1, "%lu", allowed);
+
+  sprintf (DataString, "S|%02d|%02d|BUDGET=CLAMPED,%.0f,%lu", nodeIndex, deviceIndex, requested, allowed);
+  ToInterface.SendLine (DataString);
+  return true;
+}
+
+//--- espnow_GetRoute -------------------------------------
+
+const uint8_t *Relayer::espnow_GetRoute (int nodeIndex)
+{
+  // Returns the MAC address to send to for a registered Node.
+  //
+  // The radio only holds MAX_HW_PEERS ESP-NOW peers, but there can be up to MAX_NODES Nodes.
+  // A Node that is not a peer takes the place of the least recently used peer that has
+  // nothing waiting in the send queue.  If no peer can be freed, it returns NULL: the message
+  // is broadcast and the Nodes keep only the Commands for their own nodeID (see espnow_SendToNode).
+  Peer *peer = Peers.GetPeer (nodeIndex);
+  peer->lastUsed = esp_timer_get_time ();
+
+  if (peer->hwPeer)
+    return peer->mac;
+
+  // Still a peer from before (e.g. the board moved to another nodeID)
+  if (esp_now_is_peer_exist (peer->mac))
+  {
+    Peers.SetHwPeer (nodeIndex, true);
+    Rates.Apply (peer->mac);
+    return peer->mac;
+  }
+
+  // Swap out the least recently used peer
+  if (Peers.GetNumHwPeers () >= MAX_HW_PEERS)
+  {
+    int lruIndex = -1;
+    for (int i=0; i<MAX_NODES; i++)
+    {
+      Peer *other = Peers.GetPeer (i);
+      if (other->hwPeer && !Outbox.IsQueued (other->mac))
+        if (lruIndex < 0 || other->lastUsed < Peers.GetPeer (lruIndex)->lastUsed)
+          lruIndex = i;
+    }
+
+    if (lruIndex >= 0 && esp_now_del_peer (Peers.GetMAC (lruIndex)) == ESP_OK)
+      Peers.SetHwPeer (lruIndex, false);
+  }
+
+  if (Peers.GetNumHwPeers () < MAX_HW_PEERS)
+  {
+    memcpy (PeerInfo.peer_addr, peer->mac, MAC_SIZE);
+    if (esp_now_add_peer (&PeerInfo) == ESP_OK)
+    {
+      Peers.SetHwPeer (nodeIndex, true);
+      Rates.Apply (peer->mac);
+      return peer->mac;
     }
   }
 
+  return NULL;
+}
+
+//--- espnow_SendToNode -----------------------------------
+
+esp_err_t Relayer::espnow_SendToNode (int nodeIndex, const void *data, int length, SendQoS qos, bool latest)
+{
+  // Sends to a registered Node through the send queue.
+  // Without an ESP-NOW peer for the Node, the message is broadcast once: it has no delivery
+  // status and is not retried, so it is only counted as unconfirmed (STAT) for that Node.
+  const uint8_t *mac = espnow_GetRoute (nodeIndex);
+
+  if (mac == NULL)
+  {
+    ++Counters.txUnconfirmed;
+    ++Peers.GetPeer (nodeIndex)->numUnconfirmed;
+  }
+
+  return Outbox.Send (mac, data, length, qos, latest);
+}
+
+//--- espnow_SendPeerEntry --------------------------------
+
+void Relayer::espnow_SendPeerEntry (int toNode, int peerNode)
+{
+  // Send one peer directory entry to a Node:
+  //   C|nn|--|PEER|mm,xx:xx:xx:xx:xx:xx  (Node mm is registered)
+  //   C|nn|--|PEER|mm                    (Node mm is unknown)
+  char  entry[40];
+
+  if (Peers.IsRegistered (peerNode))
+  {
+    uint8_t *mac = Peers.GetMAC (peerNode);
+    sprintf (entry, "C|%02d|--|PEER|%02d,%02X:%02X:%02X:%02X:%02X:%02X", toNode, peerNode, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  }
+  else if (peerNode >= 0 && peerNode < MAX_NODES)
+    sprintf (entry, "C|%02d|--|PEER|%02d", toNode, peerNode);
+  else
+    return;
+
+  if (espnow_SendToNode (toNode, entry, strlen (entry) + 1, SEND_RELIABLE) != ESP_OK)
+    Peers.RecordSendFailure (toNode);
+}
+
+
+//=========================================================
+// External "C" Functions
+//=========================================================
+
+//--- RadioTask -------------------------------------------
+
+void RadioTask (void *relayer)
+{
+  // Sleeps until woken by a received frame or a command,
+  // or for one tick so retries and timeouts are still serviced
+  while (true)
+  {
+    ((Relayer *) relayer)->radio_Run ();
+    ulTaskNotifyTake (pdTRUE, 1);
+  }
+}
+
+//--- SerialTask ------------------------------------------
+
+void SerialTask (void *relayer)
+{
+  // Sleeps until woken by a line from the radio task, or for one tick to poll Serial
+  while (true)
+  {
+    ((Relayer *) relayer)->serial_Run ();
+    ulTaskNotifyTake (pdTRUE, 1);
+  }
+}
+
+//--- SerialReceived --------------------------------------
+
+void SerialReceived ()
+{
+  // Called from the UART event task when bytes arrive
+  if (SerialTaskHandle != NULL)
+    xTaskNotifyGive (SerialTaskHandle);
+}
+
+//--- ESPNOW_Receiver -------------------------------------
+
+IRAM_ATTR void ESPNOW_Receiver (const esp_now_recv_info_t *info, const uint8_t *espnowString, int stringLength)
+{
+  // This is called from the WiFi task, so do as little as possible here.
+  // ASAP, copy the frame with its source MAC, signal info and capture time
+  // into the receive queue, then wake the radio task to process it.
+  ESPNOW_Queue.Push (info, espnowString, stringLength, RadioTimestamp (info));
+
+  if (RadioTaskHandle != NULL)
+    xTaskNotifyGive (RadioTaskHandle);
+}
+
+//--- ESPNOW_SendFailed -----------------------------------
+
+void ESPNOW_SendFailed (const uint8_t *mac, const uint8_t *data, int length, bool final)
+{
+  // Called by Outbox.Service() in the radio task for every failed send
+  // (broadcasts have no delivery status, so <mac> is always a Node's own MAC address)
+  int nodeIndex = Peers.FindNode (mac);
+  Peers.RecordSendFailure (nodeIndex);
+
+  // Let the Interface know when a message is given up on
+  if (final)
+  {
+    if (length > 0 && data[length-1] == 0) --length;  // Don't print the terminator
+    if (length > 160) length = 160;
+
+    if (nodeIndex >= 0)
+      sprintf (DataString, "S|--|--|ERROR: ESP-NOW message to Node %02d lost: %.*s", nodeIndex, length, (const char *) data);
+    else  // The Node's board was replaced meanwhile
+      sprintf (DataString, "S|--|--|ERROR: ESP-NOW message to %02X:%02X:%02X:%02X:%02X:%02X lost: %.*s",
+               mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], length, (const char *) data);
+    ToInterface.SendLine (DataString);
+  }
+}
+
+//--- IsEStop ---------------------------------------------
+
+bool IsEStop (const char *line, int length)
+{
+  // E|nn|dd|cccc with nn = 00-99, -- or G0-G9 and dd = 00-99 or --
+  if (length < MIN_COMMAND_LENGTH || line[1] != '|' || line[4] != '|' || line[7] != '|')
+    return false;
+
+  bool node   = ParseID (line + 2) >= 0 || (line[2] == '-' && line[3] == '-') || (line[2] == 'G' && isdigit (line[3]));
+  bool device = ParseID (line + 5) >= 0 || (line[5] == '-' && line[6] == '-');
+
+  return node && device;
+}
+
+//--- IsLinkCommand ---------------------------------------
+
+bool IsLinkCommand (const char *commandString)
+{
+  // Commands for the serial link itself, run by the serial task (see serial_RunCommand)
+  static const char *linkCommands[] = { "GMAC", "GTXQ", "GPIP", "SBAU", "STIM", "SUPM" };
+
+  for (int i=0; i<(int)(sizeof(linkCommands)/sizeof(linkCommands[0])); i++)
+    if (strncmp (commandString + VC_OFFSET, linkCommands[i], COMMAND_SIZE) == 0)
+      return true;
+
+  return false;
+}
+
+//--- IsMulticast -----------------------------------------
+
+bool IsMulticast (const char *string)
+{
+  // Command String for all Nodes (--) or a group (G0-G9)?
+  return ((string[2] == '-' && string[3] == '-') || (string[2] == 'G' && isdigit (string[3])));
+}
+
+//--- RadioTimestamp --------------------------------------
+
+IRAM_ATTR int64_t RadioTimestamp (const esp_now_recv_info_t *info)
+{
+  // Returns the time the frame arrived at the radio, in microseconds since boot.
+  //
+  // The radio stamps each frame (rx_ctrl->timestamp) with its own 32-bit microsecond
+  // clock, but the callback runs some time later.  The difference between the two clocks
+  // is smallest for frames that were handled right away, so the smallest difference
+  // seen recently is the clock offset, and anything more is callback delay.
+  // Subtracting that delay from the 64-bit esp_timer gives a wrap-free capture time.
+  static uint32_t  minDelta     = 0xFFFFFFFF;  // Smallest difference in this window
+  static uint32_t  lastMinDelta = 0xFFFFFFFF;  // Smallest difference in the last window
+  static int64_t   windowStart  = 0;
+
+  int64_t now = esp_timer_get_time ();
+  if (info == NULL || info->rx_ctrl == NULL)
+    return now;
+
+  uint32_t delta = (uint32_t) now - (uint32_t) info->rx_ctrl->timestamp;
+
+  // Restart the window every few seconds so clock drift is followed
+  if (now - windowStart >= RADIO_CLOCK_WINDOW)
+  {
+    lastMinDelta = minDelta;
+    minDelta     = 0xFFFFFFFF;
+    windowStart  = now;
+  }
+
+  if (delta < minDelta) minDelta = delta;
+
+  uint32_t offset = (lastMinDelta < minDelta) ? lastMinDelta : minDelta;
+  uint32_t delay  = delta - offset;
+
+  // Ignore a delay that can't be real (radio clock restarted)
+  if (delay > RADIO_MAX_DELAY)
+    return now;
+
+  return now - delay;
+}
+
+//--- SurveySniffer ---------------------------------------
+
+IRAM_ATTR void SurveySniffer (void *buffer, wifi_promiscuous_pkt_type_t type)
+{
+  // Promiscuous callback (WiFi task) while a channel survey is running.
+  // Adds up the frames heard on the surveyed channel, except the SMAC network's own frames to this Relayer.
+  const wifi_promiscuous_pkt_t *packet  = (const wifi_promiscuous_pkt_t *) buffer;
+  int                           channel = SampledChannel;
+
+  if (channel == 0 || packet->rx_ctrl.channel != channel)
+    return;
+
+  // Address 1 (receiver) follows the 2-byte frame control and 2-byte duration
+  if (packet->rx_ctrl.sig_len >= 4 + MAC_SIZE && memcmp (packet->payload + 4, OwnMAC, MAC_SIZE) == 0)
+    return;
+
+  SurveyFrames[channel]  = SurveyFrames[channel] + 1;
+  SurveyAirtime[channel] = SurveyAirtime[channel] + FrameAirtime (&packet->rx_ctrl);
+}
+
+//--- FrameAirtime ----------------------------------------
+
+IRAM_ATTR uint32_t FrameAirtime (const wifi_pkt_rx_ctrl_t *rxControl)
+{
+  // Rough airtime of a received frame (microseconds): preamble plus the frame at its PHY rate.
+  // Rates are in 100 kbps: legacy rates by the rate field, HT rates by MCS (20 MHz, long GI).
+  static const uint16_t  legacyRates[16] = { 10, 20, 55, 110, 10, 20, 55, 110, 480, 240, 120, 60, 540, 360, 180, 90 };
+  static const uint16_t  htRates[8]      = { 65, 130, 195, 260, 390, 520, 585, 650 };
+  uint32_t               rate, preamble;
+
+  if (rxControl->sig_mode == 0)
+  {
+    rate     = legacyRates[rxControl->rate & 0x0F];
+    preamble = (rxControl->rate < 8) ? 192 : 20;  // 802.11b long preamble, or OFDM
+  }
   else
-    Serial.println ("S|--|--|ERROR: Unknown ESP-NOW Message string.");
+  {
+    rate     = htRates[rxControl->mcs & 0x07] * (1 + (rxControl->mcs >> 3));  // Times the spatial streams
+    preamble = 36;
+  }
 
-  // Unlock
-  ProcessingESPNOWString = false;
+  return preamble + (uint32_t) rxControl->sig_len * 80 / rate;
 }
@@ -13,12 +13,28 @@
 #ifndef RELAYER_H
 #define RELAYER_H
 
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include <esp_err.h>
+
 //--- Defines ---------------------------------------------
 
-#define SERIAL_BAUDRATE      115200  // Serial comms with the Serial Monitor
+#define SERIAL_BAUDRATE      115200  // Serial comms with the Serial Monitor (start up rate, see SBAU command)
+#define SERIAL_RX_BUFFER       4096  // Serial driver receive buffer size
+#define SERIAL_TX_BUFFER       8192  // Serial driver transmit buffer size
 #define MAX_MESSAGE_LENGTH      250  // Max message size for ESP-NOW protocol
+#define SERIAL_READ_CHUNK       256  // Bytes taken from the serial driver per read
+#define SERIAL_LINE_LENGTH     2048  // Longest line from the Interface (a batch line holds many Command Strings)
+#define SERIAL_RX_TIMEOUT         2  // UART receive timeout (symbols) before the serial task is woken
+
+#define BATCH_PREFIX           "B|"  // Batch line: B|C|nn|dd|CCCC|params;C|nn|dd|CCCC|params;...
+#define BATCH_PREFIX_LENGTH       2
+#define BATCH_SEPARATOR         ';'  // Commands in a batch line can't have a ';' in their params
+#define LATEST_PREFIX           '~'  // Latest-wins Command String: ~C|nn|dd|CCCC|params (see SendQueue.h)
 
-#define MAX_NODES                20  // Maximum number of ESP-NOW peers
+#define MAX_NODES               100  // Maximum number of Nodes (the full two-digit nodeID range 00-99)
+#define MAX_HW_PEERS             18  // ESP-NOW peers kept in the radio's peer table (it holds 20, including broadcast)
 #define MAC_SIZE                  6  // Size of ESP32 MAC Address
 #define COMMAND_SIZE              4  // Size of SMAC Commands
 #define VC_OFFSET                 8  // Values or Command Offset into Data or Command String
@@ -26,8 +42,116 @@
 #define MIN_DATA_LENGTH           9  // Minimum ESP-NOW Data String    : W|nn|dd|values
 #define MAX_DATA_LENGTH         238  // Maximum ESP-NOW Data String    : W|nn|dd|values...|timestamp
 #define MIN_COMMAND_LENGTH       12  // Minimum ESP-NOW Command String : C|nn|dd|cccc
-#define MAX_TIMESTAMP_LENGTH     12  // A '|' char and timestamp is appended to Data strings
+#define MAX_TIMESTAMP_LENGTH     21  // A '|' char and 64-bit microsecond timestamp is appended to Data strings
                                      // before relaying to the SMAC Interface
+#define MAX_FRAGMENTS            10  // Most ESP-NOW fragments of one long Data String (see Reassembler.h, no Node may be built with more)
+#define FRAGMENT_CHUNK          220  // Values carried by each fragment (must match common.h of the Nodes)
+#define MAX_LONG_LENGTH         (VC_OFFSET + MAX_FRAGMENTS*FRAGMENT_CHUNK)  // Longest reassembled Data String: d|nn|dd|values
+
+#define RADIO_CLOCK_WINDOW 10000000L  // Microseconds per window when matching the radio clock to esp_timer
+#define RADIO_MAX_DELAY      100000L  // Longest believable receive callback delay (microseconds)
+
+#define ESTOP_BROADCASTS          3  // Broadcast copies of each emergency stop (besides the priority unicasts)
+#define ESTOP_TRACK              16  // Recent emergency stops tracked for their latency
+
+#define DISCOVERY_WINDOW          4  // Nodes asked for System Info at the same time (see SYSI command)
+#define DISCOVERY_TIMEOUT   500000L  // Microseconds to wait for the next System Info reply of a Node
+
+#define MAX_SILENT_DURATION   10000  // Millis of silence before an idle Node sends a heartbeat (must match common.h of the Nodes)
+#define LIVENESS_HEARTBEATS     2.5  // Heartbeats a Node may miss before it is reported down
+#define LIVENESS_DOWN_TIME     ((uint32_t)(LIVENESS_HEARTBEATS*MAX_SILENT_DURATION))  // Default millis (see SLIV command)
+#define LIVENESS_MIN_TIME      1000
+#define LIVENESS_MAX_TIME    600000
+#define LIVENESS_CHECK_TIME     250  // Millis between liveness checks
+#define HEARTBEAT_VALUE        "HB"  // Idle Nodes send S|nn|--|HB (must match common.h of the Nodes)
+
+#define THROTTLE_CHECK_TIME    1000  // Millis between congestion checks (see STHR command)
+#define THROTTLE_LOSS_PERCENT    20  // Percent of the sends retried or lost in a check that means congestion
+#define THROTTLE_MIN_SENDS        5  // Sends in a check needed to judge their loss
+#define THROTTLE_MAX_FACTOR      16  // Most the Nodes' periodic processes are slowed down (must match common.h of the Nodes)
+#define THROTTLE_STEP          0.1f  // Share of the full rate given back after each check without congestion
+#define THROTTLE_REFRESH_TIME  2000  // Millis between repeats of the throttle broadcast (Nodes drop it after THROTTLE_HOLD_TIME)
+
+#define MAX_CHANNEL              13  // WiFi channels 1-13 can be surveyed and switched to
+#define SURVEY_DWELL            100  // Default millis listening on each channel (see SURV command)
+#define SURVEY_MAX_DWELL       1000
+#define SURVEY_HOME_TIME         50  // Millis back on the home channel between surveyed channels
+#define SURVEY_MARGIN            20  // A channel must be this much (percent) less busy than the home channel to be picked
+#define CHANNEL_SWITCH_DELAY   1000  // Default millis from a WFCH command to the channel switch
+#define CHANNEL_MIN_DELAY       100
+#define CHANNEL_MAX_DELAY     10000
+#define CHANNEL_ANNOUNCE        200  // Millis between announcements of a scheduled switch
+#define RENDEZVOUS_CHANNEL        1  // Stragglers look here for the new channel (must match common.h of the Nodes)
+#define RENDEZVOUS_PERIOD      1000  // Millis between visits to the rendezvous channel after a switch
+#define RENDEZVOUS_DWELL         20  // Millis of each visit
+#define RENDEZVOUS_DURATION   60000  // Millis after a switch the rendezvous channel is visited
+
+// The radio and serial tasks (see Relayer::Start).  Override with build_flags if needed.
+#ifndef RADIO_TASK_CORE
+#define RADIO_TASK_CORE           0  // Protocol core, with the WiFi driver
+#endif
+#ifndef RADIO_TASK_PRIORITY
+#define RADIO_TASK_PRIORITY       5  // Above the serial task, below the WiFi task (23)
+#endif
+#ifndef RADIO_TASK_STACK
+#define RADIO_TASK_STACK       8192
+#endif
+#ifndef SERIAL_TASK_CORE
+#define SERIAL_TASK_CORE          1  // Application core, with the USB/UART driver
+#endif
+#ifndef SERIAL_TASK_PRIORITY
+#define SERIAL_TASK_PRIORITY      4
+#endif
+#ifndef SERIAL_TASK_STACK
+#define SERIAL_TASK_STACK      8192
+#endif
+
+// The host link is the S3's native USB when built with ARDUINO_USB_CDC_ON_BOOT
+// (see the esp32-s3-devkitc-1-usb environment in platformio.ini), otherwise a UART bridge.
+#if ARDUINO_USB_CDC_ON_BOOT
+#define HOST_LINK_USB
+#endif
+
+//--- Declarations ----------------------------------------
+
+struct RxFrame;       // Forward declarations (see RxQueue.h
+struct AggStream;     // Aggregator.h
+struct Reassembly;    // Reassembler.h
+enum   SendQoS : int; // and SendQueue.h)
+
+//--- Types -----------------------------------------------
+
+enum DiscoveryState
+{
+  DISCOVERY_IDLE,
+  DISCOVERY_PENDING,  // Waiting for a free slot in the discovery window
+  DISCOVERY_ACTIVE    // Asked for Node and Device info, waiting for replies
+};
+
+struct DiscoveryNode
+{
+  DiscoveryState  state;
+  int             numDevices;      // From the NOINFO reply, -1 until it arrives
+  int             devicesFound;    // DEINFO replies so far
+  int64_t         lastReplyTime;   // Time of the request or the last reply (microseconds)
+};
+
+struct CongestionSample
+{
+  uint32_t  rxDropped;    // ESP-NOW frames dropped by a full receive queue
+  uint32_t  lineDropped;  // Lines dropped on the way to the serial task
+  uint32_t  sent;         // Unicast sends
+  uint32_t  failed;       // Unicast sends retried or lost
+  uint32_t  gaps;         // Long Data Strings with fragments that never came
+};
+
+struct EStopRecord
+{
+  uint16_t  seq;           // Sequence number sent with the emergency stop
+  int64_t   receivedTime;  // Time the serial task read it from the Interface (microseconds)
+  int       numTargets;    // Registered Nodes it was sent to
+  int       numAcks;       // Nodes that reported it executed
+};
 
 //=========================================================
 //  class Relayer
@@ -36,19 +160,135 @@
 class Relayer
 {
   protected:
-    bool  startupStatus = false;
-    char  commandString[MAX_ESPNOW_LENGTH+1] = "";
-    int   commandLength = 0;
-    char  serial_NextChar;
+    bool      startupStatus = false;
+
+    //--- Serial task ---
+    char      serialLine[SERIAL_LINE_LENGTH] = "";  // Line being read from the Interface
+    int       serialLength   = 0;
+    bool      serialOverflow = false;  // Line is too long, ignore it up to the next newline
+
+    //--- Radio task ---
+    char      commandString[MAX_ESPNOW_LENGTH+1] = "";  // Command String being processed
+    int       commandLength = 0;
+    bool      commandLatest = false;  // Only the newest of these commands waiting for a Node is sent
+    uint32_t  reportedDrops = 0;  // Number of dropped ESP-NOW frames already reported to the Interface
+
+    //--- System Info discovery job (SYSI) ---
+    DiscoveryNode  discoveryNodes[MAX_NODES] = {};
+    bool           discoveryRunning  = false;
+    int            discoveryActive   = 0;  // Nodes asked and not finished
+    int            discoveryFound    = 0;  // Nodes that sent all their info
+    int            discoveryCached   = 0;  // Nodes answered from their twins
+    int            discoveryTimeouts = 0;  // Nodes that stopped replying
+    int64_t        discoveryStart    = 0;
+
+    //--- Node liveness (NODEDOWN/NODEUP) ---
+    bool      nodeDown[MAX_NODES]  = {};
+    uint32_t  downTime[MAX_NODES]  = {};  // Millis without a frame before NODEDOWN, 0 = livenessDefault
+    uint32_t  livenessDefault      = LIVENESS_DOWN_TIME;
+    int64_t   lastLivenessCheck    = 0;
+
+    //--- Congestion control (THRO) ---
+    bool              throttleEnabled   = true;
+    float             throttleRate      = 1.0f;  // Share of their set rates the Nodes may use (1 / throttle factor)
+    CongestionSample  throttleLast      = {};    // Counters at the last check
+    CongestionSample  throttleDelta     = {};    // Counts during the last check
+    int64_t           lastThrottleCheck = 0;
+    int64_t           lastThrottleSend  = 0;
+
+    //--- Emergency stops (E|nn|dd|cccc) ---
+    EStopRecord  estops[ESTOP_TRACK] = {};
+    uint16_t     nextEStopSeq      = 1;
+    uint32_t     estopSent         = 0;
+    uint32_t     estopAcks         = 0;
+    int64_t      estopLastLatency  = 0;  // Interface read to Node report (microseconds)
+    int64_t      estopMaxLatency   = 0;
+
+    //--- WiFi channel survey (SURV) and synchronized switch (WFCH) ---
+    uint8_t   homeChannel      = 1;      // Channel of the SMAC network
+    int       surveyChannel    = 0;      // Channel being surveyed, 0 = no survey
+    bool      surveyAtHome     = false;  // Back on the home channel between surveyed channels
+    bool      surveyAutoSwitch = false;  // Switch to the best channel when done
+    int64_t   surveyDwell      = 0;      // Microseconds on each surveyed channel
+    int64_t   surveyStepTime   = 0;
+    uint8_t   switchChannel    = 0;      // Channel of a scheduled switch, 0 = none
+    int64_t   switchTime       = 0;
+    int64_t   lastAnnounce     = 0;
+    int64_t   rendezvousUntil  = 0;      // Visit the rendezvous channel until then
+    int64_t   lastRendezvous   = 0;
+    bool      atRendezvous     = false;
+
+    //--- Periodic STAT reports ---
+    int64_t   statPeriod   = 0;  // Microseconds between reports, 0 = off
+    int64_t   lastStatTime = 0;
 
     void serial_CheckInput        ();
-    void serial_ProcessCommand    ();
+    void serial_AddChars          (const char *chars, int count);
+    void serial_EndLine           ();
+    void serial_ProcessLine       (const char *line, int length);
+    void serial_DrainLines        ();
+    void serial_RunCommand        (const char *command, int length);
+    void serial_SetBaudRate       (const char *line, int length);
+    void radio_CheckCommands      ();
+    void radio_ProcessCommand     ();
+    void radio_SendLinkStats      ();
+    void radio_SendStats          ();
     void espnow_SendCommandString ();
+    bool espnow_SendMulticast     (const char *string, int length);
+    void espnow_SendPeerEntry     (int toNode, int peerNode);
+    void espnow_CheckQueue        ();
+    void espnow_ProcessFrame      (RxFrame *frame);
+    void stream_SetPolicy         ();
+    void stream_SendList          ();
+    void stream_Service           (int64_t now);
+    void stream_Send              (AggStream *stream);
+    void fragment_Receive         (RxFrame *frame);
+    void fragment_SendAck         (int nodeIndex, Reassembly *message, bool complete);
+    void estop_Send               (const char *line, int64_t receivedTime);
+    void estop_CheckAck           (int nodeIndex, RxFrame *frame);
+    void rate_Set                 ();
+    void rate_SendList            ();
+    void group_Define             ();
+    void group_Delete             ();
+    void group_SendList           ();
+    void group_SendMembership     (int groupIndex, int nodeIndex);
+    void channel_StartSurvey      ();
+    void channel_FinishSurvey     (bool cancelled);
+    void channel_Schedule         (const char *params);
+    void channel_Announce         (int64_t now);
+    void channel_Service          (int64_t now);
+    void discovery_Start          ();
+    void discovery_Service        ();
+    void discovery_CheckReply     (int nodeIndex, const char *values);
+    void discovery_Finish         (int nodeIndex, bool timedOut);
+    void liveness_Set             ();
+    void liveness_SendList        ();
+    void liveness_Service         (int64_t now);
+    void liveness_Up              (int nodeIndex, int64_t timestamp);
+    void throttle_Set             ();
+    void throttle_Report          ();
+    void throttle_Service         (int64_t now);
+    void throttle_Broadcast       (int64_t now);
+    bool mailbox_Put              (int nodeIndex, const char *text, int length, bool latest);
+    void mailbox_Deliver          (int nodeIndex);
+    void mailbox_Service          (int64_t now);
+    void mailbox_Set              ();
+    void mailbox_SendList         ();
+    void twin_SendInfo            (int nodeIndex);
+    void twin_SendLastValue       ();
+    void budget_Set               ();
+    void budget_SendReport        ();
+    bool budget_CheckRate         ();
+
+    const uint8_t *espnow_GetRoute   (int nodeIndex);  // MAC address to send to a Node (may swap ESP-NOW peers), NULL = broadcast
+    esp_err_t      espnow_SendToNode (int nodeIndex, const void *data, int length, SendQoS qos, bool latest=false);
 
   public:
-    Relayer      ();
-    bool  IsOkay ();
-    void  Run    ();
+    Relayer          ();
+    bool  IsOkay     ();
+    bool  Start      ();  // Start the radio and serial tasks
+    void  radio_Run  ();  // One pass of the radio task
+    void  serial_Run ();  // One pass of the serial task
 };
 
 #endif
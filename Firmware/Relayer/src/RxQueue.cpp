@@ -0,0 +1,116 @@
+//=========================================================
+//
+//     FILE : RxQueue.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Implements a fixed-slot, lock-free, single-producer/single-consumer
+//            queue of incoming ESP-NOW frames.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "RxQueue.h"
+
+//--- Declarations ----------------------------------------
+
+uint32_t FrameAirtime (const wifi_pkt_rx_ctrl_t *rxControl);
+
+//--- Constructor -----------------------------------------
+
+RxQueue::RxQueue ()
+{
+  headIndex  = 0;
+  tailIndex  = 0;
+  numDropped = 0;
+  highWater  = 0;
+}
+
+//--- Push ------------------------------------------------
+
+IRAM_ATTR bool RxQueue::Push (const esp_now_recv_info_t *info, const uint8_t *data, int length, int64_t timestamp)
+{
+  // Indexes run freely and wrap naturally; (tail - head) is the number of waiting frames
+  uint32_t tail  = tailIndex.load (std::memory_order_relaxed);
+  uint32_t depth = tail - headIndex.load (std::memory_order_acquire);
+
+  if (depth >= RX_QUEUE_SLOTS)
+  {
+    // Full, drop this frame
+    ++numDropped;
+    return false;
+  }
+
+  // Copy frame into the free slot
+  RxFrame *frame = &slots[tail & (RX_QUEUE_SLOTS - 1)];
+
+  if (length < 0) length = 0;
+  if (length > MAX_ESPNOW_LENGTH) length = MAX_ESPNOW_LENGTH;
+
+  memcpy (frame->srcMAC, info->src_addr, MAC_SIZE);
+  frame->rssi       = info->rx_ctrl->rssi;
+  frame->noiseFloor = info->rx_ctrl->noise_floor;
+  frame->airtime    = (uint16_t) FrameAirtime (info->rx_ctrl);
+  frame->timestamp  = timestamp;
+  frame->broadcast  = (info->des_addr != NULL && (info->des_addr[0] & 0x01));  // Group bit set
+  frame->length     = length;
+  memcpy (frame->data, data, length);
+  frame->data[length] = 0;  // Nodes send the terminator, but don't count on it
+
+  // Publish the slot to the consumer
+  tailIndex.store (tail + 1, std::memory_order_release);
+
+  if (depth + 1 > highWater)
+    highWater = depth + 1;
+
+  return true;
+}
+
+//--- Peek ------------------------------------------------
+
+RxFrame *RxQueue::Peek ()
+{
+  uint32_t head = headIndex.load (std::memory_order_relaxed);
+
+  if (head == tailIndex.load (std::memory_order_acquire))
+    return NULL;  // Empty
+
+  return &slots[head & (RX_QUEUE_SLOTS - 1)];
+}
+
+//--- Pop -------------------------------------------------
+
+void RxQueue::Pop ()
+{
+  uint32_t head = headIndex.load (std::memory_order_relaxed);
+
+  if (head != tailIndex.load (std::memory_order_acquire))
+    headIndex.store (head + 1, std::memory_order_release);  // Give the slot back to the producer
+}
+
+//--- GetDepth --------------------------------------------
+
+int RxQueue::GetDepth ()
+{
+  return (int)(tailIndex.load (std::memory_order_acquire) - headIndex.load (std::memory_order_acquire));
+}
+
+//--- GetDropped ------------------------------------------
+
+uint32_t RxQueue::GetDropped ()
+{
+  return numDropped;
+}
+
+//--- GetHighWater ----------------------------------------
+
+uint32_t RxQueue::GetHighWater ()
+{
+  return highWater;
+}
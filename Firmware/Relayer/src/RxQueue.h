@@ -0,0 +1,76 @@
+//=========================================================
+//
+//     FILE : RxQueue.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Implements a fixed-slot, lock-free, single-producer/single-consumer
+//            queue of incoming ESP-NOW frames.
+//
+//            █ The producer is the ESP-NOW receive callback (WiFi task).
+//              It copies each frame into the next free slot and returns right away.
+//
+//            █ The consumer is the Relayer's radio task.
+//              It reads frames in place with Peek() and releases them with Pop().
+//
+//            █ If the queue is full, the new frame is dropped and counted.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef RXQUEUE_H
+#define RXQUEUE_H
+
+//--- Includes --------------------------------------------
+
+#include <atomic>
+#include <esp_now.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define RX_QUEUE_SLOTS  32  // Number of frame slots (must be a power of 2)
+
+//--- Types -----------------------------------------------
+
+struct RxFrame
+{
+  uint8_t        srcMAC[MAC_SIZE];               // MAC address of the sending peer
+  int8_t         rssi;                           // Signal strength of the frame (dBm)
+  int8_t         noiseFloor;                     // Noise floor when the frame was received (dBm)
+  uint16_t       airtime;                        // Rough airtime of the frame (microseconds)
+  int64_t        timestamp;                      // Capture time of the frame (microseconds since boot)
+  bool           broadcast;                      // Sent to the broadcast address (every Node got it too)
+  int            length;                         // Number of bytes in data (including any NULL terminator)
+  char           data[MAX_ESPNOW_LENGTH+1];      // Copy of the frame, always NULL terminated
+};
+
+
+//=========================================================
+//  class RxQueue
+//=========================================================
+
+class RxQueue
+{
+  protected:
+    RxFrame                slots[RX_QUEUE_SLOTS];
+    std::atomic<uint32_t>  headIndex;   // Next slot to read  (only changed by the consumer)
+    std::atomic<uint32_t>  tailIndex;   // Next slot to write (only changed by the producer)
+    volatile uint32_t      numDropped;  // Frames dropped because the queue was full
+    volatile uint32_t      highWater;   // Largest number of frames ever waiting
+
+  public:
+    RxQueue ();
+
+    bool      Push         (const esp_now_recv_info_t *info, const uint8_t *data, int length, int64_t timestamp);  // Producer only
+    RxFrame  *Peek         ();  // Consumer only: oldest frame or NULL, valid until Pop()
+    void      Pop          ();  // Consumer only: release the oldest frame
+    int       GetDepth     ();
+    uint32_t  GetDropped   ();
+    uint32_t  GetHighWater ();
+};
+
+#endif
@@ -0,0 +1,474 @@
+//=========================================================
+//
+//     FILE : SendQueue.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : SendQueue class:
+//            Delivers outgoing ESP-NOW messages with delivery status tracking.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "SendQueue.h"
+#include "RateControl.h"
+
+//--- Declarations ----------------------------------------
+
+void ESPNOW_SendComplete (const uint8_t *mac, esp_now_send_status_t status);
+
+SendQueue      *ActiveSendQueue = NULL;  // The queue that receives the ESP-NOW send callbacks
+const uint8_t  SendBroadcastMAC[MAC_SIZE] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+//--- Constructor -----------------------------------------
+
+SendQueue::SendQueue ()
+{
+  memset (entries, 0, sizeof(entries));
+  memset (lates,   0, sizeof(lates));
+  statusHead = 0;
+  statusTail = 0;
+  statusLost = false;
+}
+
+//--- Begin -----------------------------------------------
+
+bool SendQueue::Begin ()
+{
+  ActiveSendQueue = this;
+  return (esp_now_register_send_cb (ESPNOW_SendComplete) == ESP_OK);
+}
+
+//--- SetFailedHandler ------------------------------------
+
+void SendQueue::SetFailedHandler (SendFailedHandler handler)
+{
+  // The handler must not send ESP-NOW messages itself
+  failedHandler = handler;
+}
+
+//--- SetRateControl --------------------------------------
+
+void SendQueue::SetRateControl (RateControl *rates)
+{
+  rateControl = rates;
+}
+
+//--- SetWindow -------------------------------------------
+
+void SendQueue::SetWindow (int newWindow)
+{
+  if (newWindow < 1) newWindow = 1;
+  if (newWindow > SEND_MAX_WINDOW) newWindow = SEND_MAX_WINDOW;
+
+  window = newWindow;
+}
+
+//--- GetWindow -------------------------------------------
+
+int SendQueue::GetWindow ()
+{
+  return window;
+}
+
+//--- Send ------------------------------------------------
+
+esp_err_t SendQueue::Send (const uint8_t *mac, const void *data, int length, SendQoS qos, bool latest)
+{
+  // Broadcasts can't be tracked, send right away
+  if (mac == NULL)
+    return esp_now_send (SendBroadcastMAC, (const uint8_t *) data, length);
+
+  if (length < 0 || length > MAX_ESPNOW_LENGTH)
+    return ESP_FAIL;
+
+  // Catch up on delivery statuses first so slots are freed
+  Service ();
+
+  int64_t now = esp_timer_get_time ();
+
+  // Latest wins: overwrite the older message where it waits, keeping its place in line
+  SendEntry *entry = latest ? waiting (mac, data, length) : NULL;
+  if (entry != NULL)
+  {
+    ++numCoalesced;
+    entry->numRetries = 0;
+    entry->length     = length;
+    memcpy (entry->data, data, length);
+    return ESP_OK;
+  }
+
+  entry = allocate (qos);
+  if (entry == NULL)
+    return ESP_ERR_ESPNOW_NO_MEM;
+
+  entry->state      = SEND_WAITING;
+  entry->qos        = qos;
+  entry->latest     = latest;
+  entry->order      = nextOrder++;
+  entry->numRetries = 0;
+  entry->time       = now;
+  entry->length     = length;
+  memcpy (entry->mac, mac, MAC_SIZE);
+  memcpy (entry->data, data, length);
+
+  // Send it now if its peer's window allows
+  pump (now);
+
+  return ESP_OK;
+}
+
+//--- Service ---------------------------------------------
+
+void SendQueue::Service ()
+{
+  int64_t   now  = esp_timer_get_time ();
+  uint32_t  head = statusHead.load (std::memory_order_relaxed);
+
+  // Match each delivery status to the oldest in-flight message of its peer,
+  // unless it is the late status of a message that already timed out
+  while (head != statusTail.load (std::memory_order_acquire))
+  {
+    SendStatus *status = &statuses[head & (SEND_STATUS_SLOTS - 1)];
+
+    if (takeLate (status->mac))
+      ++numLate;
+    else
+    {
+      SendEntry *entry = inFlight (status->mac);
+      if (entry != NULL)
+        complete (entry, status->delivered, now);
+    }
+
+    statusHead.store (++head, std::memory_order_release);
+  }
+
+  // A lost status may never come, so don't wait for the statuses of what is in flight now
+  if (statusLost.exchange (false))
+  {
+    memset (lates, 0, sizeof(lates));
+    for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+      if (entries[i].state == SEND_IN_FLIGHT)
+        entries[i].unsure = true;
+  }
+
+  if (numQueued == 0)
+    return;
+
+  // A status that never came is a failed send (and the status may still come)
+  for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+  {
+    if (entries[i].state == SEND_IN_FLIGHT && now - entries[i].time > SEND_TIMEOUT)
+    {
+      if (!entries[i].unsure)
+        addLate (entries[i].mac);
+
+      complete (&entries[i], false, now);
+    }
+  }
+
+  pump (now);
+}
+
+//--- PushStatus ------------------------------------------
+
+IRAM_ATTR void SendQueue::PushStatus (const uint8_t *mac, bool delivered)
+{
+  uint32_t tail = statusTail.load (std::memory_order_relaxed);
+
+  if (mac == NULL)
+    return;
+
+  // If full, the message times out and counts as failed
+  if (tail - statusHead.load (std::memory_order_acquire) >= SEND_STATUS_SLOTS)
+  {
+    statusLost.store (true);
+    return;
+  }
+
+  SendStatus *status = &statuses[tail & (SEND_STATUS_SLOTS - 1)];
+  memcpy (status->mac, mac, MAC_SIZE);
+  status->delivered = delivered;
+
+  statusTail.store (tail + 1, std::memory_order_release);
+}
+
+//--- IsQueued --------------------------------------------
+
+bool SendQueue::IsQueued (const uint8_t *mac)
+{
+  for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+    if (entries[i].state != SEND_FREE && memcmp (entries[i].mac, mac, MAC_SIZE) == 0)
+      return true;
+
+  return false;
+}
+
+//--- GetWaiting ------------------------------------------
+
+int SendQueue::GetWaiting ()
+{
+  int count = 0;
+  for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+    if (entries[i].state == SEND_WAITING) ++count;
+
+  return count;
+}
+
+//--- GetInFlight -----------------------------------------
+
+int SendQueue::GetInFlight ()
+{
+  int count = 0;
+  for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+    if (entries[i].state == SEND_IN_FLIGHT) ++count;
+
+  return count;
+}
+
+//--- Counters --------------------------------------------
+
+uint32_t SendQueue::GetSent      () { return numSent;      }
+uint32_t SendQueue::GetBytesSent () { return numBytesSent; }
+uint32_t SendQueue::GetDelivered () { return numDelivered; }
+uint32_t SendQueue::GetRetries   () { return numRetries;   }
+uint32_t SendQueue::GetLost      () { return numLost;      }
+uint32_t SendQueue::GetDropped   () { return numDropped;   }
+uint32_t SendQueue::GetCoalesced () { return numCoalesced; }
+uint32_t SendQueue::GetLate      () { return numLate;      }
+
+//--- allocate --------------------------------------------
+
+SendEntry *SendQueue::allocate (SendQoS qos)
+{
+  for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+  {
+    if (entries[i].state == SEND_FREE)
+    {
+      ++numQueued;
+      return &entries[i];
+    }
+  }
+
+  // Full; a reliable or priority message replaces the oldest waiting best-effort message
+  SendEntry *oldest = NULL;
+  if (qos != SEND_BEST_EFFORT)
+  {
+    for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+      if (entries[i].state == SEND_WAITING && entries[i].qos == SEND_BEST_EFFORT)
+        if (oldest == NULL || (int32_t)(entries[i].order - oldest->order) < 0)
+          oldest = &entries[i];
+  }
+
+  ++numDropped;
+  return oldest;
+}
+
+//--- waiting ---------------------------------------------
+
+SendEntry *SendQueue::waiting (const uint8_t *mac, const void *data, int length)
+{
+  if (length < SEND_LATEST_KEY)
+    return NULL;
+
+  for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+  {
+    SendEntry *entry = &entries[i];
+    if (entry->state == SEND_WAITING && entry->latest && entry->length >= SEND_LATEST_KEY
+     && memcmp (entry->mac, mac, MAC_SIZE) == 0 && memcmp (entry->data, data, SEND_LATEST_KEY) == 0)
+      return entry;
+  }
+
+  return NULL;
+}
+
+//--- inFlight --------------------------------------------
+
+SendEntry *SendQueue::inFlight (const uint8_t *mac)
+{
+  SendEntry *oldest = NULL;
+
+  for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+    if (entries[i].state == SEND_IN_FLIGHT && memcmp (entries[i].mac, mac, MAC_SIZE) == 0)
+      if (oldest == NULL || (int32_t)(entries[i].sentOrder - oldest->sentOrder) < 0)
+        oldest = &entries[i];
+
+  return oldest;
+}
+
+//--- addLate ---------------------------------------------
+
+void SendQueue::addLate (const uint8_t *mac)
+{
+  SendLate *free = NULL;
+
+  for (int i=0; i<SEND_LATE_SLOTS; i++)
+  {
+    if (lates[i].count > 0 && memcmp (lates[i].mac, mac, MAC_SIZE) == 0)
+    {
+      ++lates[i].count;
+      return;
+    }
+
+    if (lates[i].count == 0 && free == NULL)
+      free = &lates[i];
+  }
+
+  // If every slot is taken, the late status is matched like before
+  if (free != NULL)
+  {
+    memcpy (free->mac, mac, MAC_SIZE);
+    free->count = 1;
+  }
+}
+
+//--- takeLate --------------------------------------------
+
+bool SendQueue::takeLate (const uint8_t *mac)
+{
+  for (int i=0; i<SEND_LATE_SLOTS; i++)
+  {
+    if (lates[i].count > 0 && memcmp (lates[i].mac, mac, MAC_SIZE) == 0)
+    {
+      --lates[i].count;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//--- pump ------------------------------------------------
+
+void SendQueue::pump (int64_t now)
+{
+  // Send the oldest message that is ready, until none are.
+  // Priority messages go first, whatever the window and order.
+  while (true)
+  {
+    SendEntry *next = NULL;
+
+    for (int i=0; i<SEND_QUEUE_SLOTS; i++)
+    {
+      SendEntry *entry = &entries[i];
+      if (entry->state != SEND_WAITING || entry->time > now)
+        continue;
+
+      bool priority = (entry->qos == SEND_PRIORITY);
+      if (next != NULL)
+      {
+        bool nextPriority = (next->qos == SEND_PRIORITY);
+        if (nextPriority && !priority)
+          continue;
+
+        if (nextPriority == priority && (int32_t)(entry->order - next->order) > 0)
+          continue;
+      }
+
+      if (priority)
+      {
+        next = entry;
+        continue;
+      }
+
+      // Keep each peer's messages in order and within its window
+      int   numInFlight = 0;
+      bool  blocked     = false;
+      for (int j=0; j<SEND_QUEUE_SLOTS && !blocked; j++)
+      {
+        SendEntry *other = &entries[j];
+        if (other == entry || other->state == SEND_FREE || memcmp (other->mac, entry->mac, MAC_SIZE) != 0)
+          continue;
+
+        if (other->state == SEND_IN_FLIGHT)
+          ++numInFlight;
+        else if ((int32_t)(other->order - entry->order) < 0)
+          blocked = true;  // An older message to this peer is still waiting
+      }
+
+      if (!blocked && numInFlight < window)
+        next = entry;
+    }
+
+    if (next == NULL)
+      return;
+
+    ++numSent;
+    esp_err_t result = esp_now_send (next->mac, next->data, next->length);
+    if (result == ESP_OK)
+    {
+      next->state     = SEND_IN_FLIGHT;
+      next->unsure    = false;
+      next->time      = now;
+      next->sentOrder = nextSentOrder++;
+      numBytesSent += next->length;
+    }
+    else if (result == ESP_ERR_ESPNOW_NO_MEM)
+    {
+      // The WiFi driver is full; try again a little later
+      --numSent;
+      next->time = now + SEND_BACKOFF;
+      return;
+    }
+    else
+      complete (next, false, now);
+  }
+}
+
+//--- complete --------------------------------------------
+
+void SendQueue::complete (SendEntry *entry, bool delivered, int64_t now)
+{
+  if (rateControl != NULL)
+    rateControl->RecordStatus (entry->mac, delivered);
+
+  if (delivered)
+  {
+    ++numDelivered;
+    entry->state = SEND_FREE;
+    --numQueued;
+    return;
+  }
+
+  bool retry = (entry->qos == SEND_RELIABLE && entry->numRetries < SEND_MAX_RETRIES) ||
+               (entry->qos == SEND_PRIORITY && entry->numRetries < SEND_PRIORITY_RETRIES);
+
+  if (failedHandler != NULL)
+    failedHandler (entry->mac, entry->data, entry->length, !retry);
+
+  if (retry)
+  {
+    // Back off, doubling the wait each time (priority messages go again right away)
+    entry->state = SEND_WAITING;
+    entry->time  = (entry->qos == SEND_PRIORITY) ? now : now + ((int64_t) SEND_BACKOFF << entry->numRetries);
+    ++entry->numRetries;
+    ++numRetries;
+  }
+  else
+  {
+    ++numLost;
+    entry->state = SEND_FREE;
+    --numQueued;
+  }
+}
+
+
+//=========================================================
+// External "C" Functions
+//=========================================================
+
+//--- ESPNOW_SendComplete ---------------------------------
+
+IRAM_ATTR void ESPNOW_SendComplete (const uint8_t *mac, esp_now_send_status_t status)
+{
+  // This is called from the WiFi task, so just queue the status for Service()
+  if (ActiveSendQueue != NULL)
+    ActiveSendQueue->PushStatus (mac, status == ESP_NOW_SEND_SUCCESS);
+}
@@ -0,0 +1,198 @@
+//=========================================================
+//
+//     FILE : SendQueue.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : SendQueue class:
+//            Delivers outgoing ESP-NOW messages with delivery status tracking.
+//
+//            █ Every unicast message is copied into a fixed pool of slots and sent from there.
+//              Messages to the same peer are always sent in order.  At most <window> messages
+//              per peer are in flight (sent, but no delivery status yet).
+//
+//            █ The ESP-NOW send callback (WiFi task) only pushes the delivery status into a small
+//              lock-free ring.  Service() matches each status to the in-flight message of that
+//              peer that was sent first, then sends whatever the windows allow.
+//
+//            █ A message without a delivery status after SEND_TIMEOUT counts as failed, but its
+//              status is still due.  Each peer keeps a count of these, and that many of its next
+//              statuses are discarded as late instead of being matched to a newer message.
+//              If the ring was full and a status was lost, the messages in flight at that time
+//              are not counted, since their status may never come.
+//
+//            █ Two classes of service:
+//
+//              ∙ SEND_BEST_EFFORT : sent once; if it fails it is counted and forgotten.
+//                                   Used for Widget Data (the next value replaces it anyway).
+//
+//              ∙ SEND_RELIABLE    : retried up to SEND_MAX_RETRIES times, waiting SEND_BACKOFF
+//                                   microseconds before the first retry and twice as long for each
+//                                   retry after that.  Used for Commands and System Data.
+//
+//              ∙ SEND_PRIORITY    : safety-critical messages (emergency stops).  Sent ahead of
+//                                   everything else, ignoring the peer's window and message order,
+//                                   and retried right away up to SEND_PRIORITY_RETRIES times.
+//
+//              When the pool is full, a reliable or priority message takes the slot of the oldest
+//              waiting best-effort message.  A best-effort message is simply dropped.
+//
+//            █ A message sent with <latest> set (a setpoint from a slider or joystick) replaces a
+//              waiting <latest> message to the same peer that starts with the same SEND_LATEST_KEY
+//              bytes (C|nn|dd|cccc), instead of queueing behind it.  Only the newest one is sent.
+//
+//            █ Broadcasts (mac = NULL) have no single delivery status, so they are sent right away
+//              to the broadcast address (esp_now_send with NULL would send a copy to every peer).
+//
+//            █ The delivery status of every unicast send is also passed to the RateControl, if one
+//              is set, so it can pick the PHY rate of each peer (see RateControl.h).
+//
+//            █ All unicast ESP-NOW sends must go through the SendQueue, otherwise
+//              their delivery status is matched to the wrong message.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef SENDQUEUE_H
+#define SENDQUEUE_H
+
+//--- Includes --------------------------------------------
+
+#include <atomic>
+#include <esp_now.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define SEND_QUEUE_SLOTS      32  // Messages waiting or in flight
+#define SEND_STATUS_SLOTS     32  // Delivery statuses waiting for Service() (must be a power of 2)
+#define SEND_WINDOW            2  // Default number of in-flight messages per peer
+#define SEND_MAX_WINDOW        8
+#define SEND_MAX_RETRIES       5  // Retries of a reliable message before it is lost
+#define SEND_PRIORITY_RETRIES 10  // Retries of a priority message (no backoff)
+#define SEND_BACKOFF        2000  // Microseconds before the first retry (doubled for each retry)
+#define SEND_TIMEOUT      100000  // Microseconds to wait for a delivery status before counting a failure
+#define SEND_LATEST_KEY   MIN_COMMAND_LENGTH  // Bytes that identify a latest-wins message (C|nn|dd|cccc)
+#define SEND_LATE_SLOTS       16  // Peers that can have delivery statuses due for timed-out messages
+
+//--- Declarations ----------------------------------------
+
+class RateControl;
+
+//--- Types -----------------------------------------------
+
+enum SendQoS : int  // (forward declared in Relayer.h)
+{
+  SEND_BEST_EFFORT,
+  SEND_RELIABLE,
+  SEND_PRIORITY
+};
+
+enum SendState
+{
+  SEND_FREE,
+  SEND_WAITING,    // Waiting to be sent (or re-sent)
+  SEND_IN_FLIGHT   // Sent, waiting for its delivery status
+};
+
+struct SendEntry
+{
+  SendState  state;
+  SendQoS    qos;
+  bool       latest;                    // Replaced by a newer message with the same key while waiting
+  bool       unsure;                    // In flight when a delivery status was lost (ring full)
+  uint8_t    mac[MAC_SIZE];
+  uint32_t   order;                     // Increases with every queued message, keeps each peer's messages in order
+  uint32_t   sentOrder;                 // Increases with every send, matches delivery statuses to messages
+  int        numRetries;
+  int64_t    time;                      // WAITING: earliest send time, IN_FLIGHT: time sent (microseconds)
+  int        length;
+  uint8_t    data[MAX_ESPNOW_LENGTH];
+};
+
+struct SendLate
+{
+  uint8_t  mac[MAC_SIZE];
+  int      count;                       // Delivery statuses still due for timed-out messages
+};
+
+struct SendStatus
+{
+  uint8_t  mac[MAC_SIZE];
+  bool     delivered;
+};
+
+// Called from Service() for every failed send.
+// <final> is true if the message will not be retried.
+typedef void (*SendFailedHandler) (const uint8_t *mac, const uint8_t *data, int length, bool final);
+
+
+//=========================================================
+//  class SendQueue
+//=========================================================
+
+class SendQueue
+{
+  protected:
+    SendEntry          entries[SEND_QUEUE_SLOTS];
+    uint32_t           nextOrder     = 0;
+    uint32_t           nextSentOrder = 0;
+    int                numQueued     = 0;     // Slots that are not free
+    int                window        = SEND_WINDOW;
+    SendFailedHandler  failedHandler = NULL;
+    RateControl       *rateControl   = NULL;
+
+    //--- Delivery statuses from the send callback ---
+    SendStatus             statuses[SEND_STATUS_SLOTS];
+    std::atomic<uint32_t>  statusHead;
+    std::atomic<uint32_t>  statusTail;
+    std::atomic<bool>      statusLost;  // A status was dropped because the ring was full
+    SendLate               lates[SEND_LATE_SLOTS];
+
+    //--- Counters ---
+    uint32_t  numSent      = 0;  // Send attempts (including retries)
+    uint32_t  numBytesSent = 0;
+    uint32_t  numDelivered = 0;
+    uint32_t  numRetries   = 0;
+    uint32_t  numLost      = 0;  // Messages that failed for good
+    uint32_t  numDropped   = 0;  // Messages that never got a slot (or lost their slot)
+    uint32_t  numCoalesced = 0;  // Latest-wins messages replaced before they were sent
+    uint32_t  numLate      = 0;  // Delivery statuses that came after their message timed out
+
+    SendEntry  *allocate  (SendQoS qos);
+    SendEntry  *inFlight  (const uint8_t *mac);  // First sent in-flight message for a peer
+    SendEntry  *waiting   (const uint8_t *mac, const void *data, int length);  // Waiting latest-wins message with the same key
+    void        pump      (int64_t now);
+    void        complete  (SendEntry *entry, bool delivered, int64_t now);
+    void        addLate   (const uint8_t *mac);  // A status of this peer is due for a timed-out message
+    bool        takeLate  (const uint8_t *mac);  // Is the next status of this peer a late one?
+
+  public:
+    SendQueue ();
+
+    bool       Begin            ();  // Register the ESP-NOW send callback; call after esp_now_init()
+    void       SetFailedHandler (SendFailedHandler handler);
+    void       SetRateControl   (RateControl *rates);
+    void       SetWindow        (int newWindow);
+    int        GetWindow        ();
+    esp_err_t  Send             (const uint8_t *mac, const void *data, int length, SendQoS qos, bool latest=false);
+    void       Service          ();  // Process delivery statuses, retries and timeouts; call from Run()
+    void       PushStatus       (const uint8_t *mac, bool delivered);  // Send callback only
+    bool       IsQueued         (const uint8_t *mac);  // Any message waiting or in flight for a peer?
+
+    int        GetWaiting       ();
+    int        GetInFlight      ();
+    uint32_t   GetSent          ();
+    uint32_t   GetBytesSent     ();
+    uint32_t   GetDelivered     ();
+    uint32_t   GetRetries       ();
+    uint32_t   GetLost          ();
+    uint32_t   GetDropped       ();
+    uint32_t   GetCoalesced     ();
+    uint32_t   GetLate          ();
+};
+
+#endif
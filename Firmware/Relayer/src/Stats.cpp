@@ -0,0 +1,54 @@
+//=========================================================
+//
+//     FILE : Stats.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Stats class:
+//            Runtime performance counters of the Relayer.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Stats.h"
+
+//--- CountRecord -----------------------------------------
+
+void Stats::CountRecord (char type)
+{
+  ++txRecords;
+
+  if (type == 'W')
+    ++relayedData;
+  else
+    ++relayedSystem;
+}
+
+//--- CountLoop -------------------------------------------
+
+void Stats::CountLoop (int64_t now)
+{
+  // Loops per second over fixed windows
+  ++windowLoops;
+
+  int64_t elapsed = now - windowStart;
+  if (elapsed >= STAT_LOOP_WINDOW)
+  {
+    loopsPerSecond = (windowStart == 0) ? 0 : (uint32_t)((int64_t) windowLoops * 1000000LL / elapsed);
+    windowLoops    = 0;
+    windowStart    = now;
+  }
+}
+
+//--- GetLoopsPerSecond -----------------------------------
+
+uint32_t Stats::GetLoopsPerSecond ()
+{
+  return loopsPerSecond;
+}
@@ -0,0 +1,113 @@
+//=========================================================
+//
+//     FILE : Stats.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Stats class:
+//            Runtime performance counters of the Relayer.
+//
+//            █ Counters are plain integers that are only changed by the radio task,
+//              so they cost one increment each.  The Interface counters (cmdIn, cmdBytes,
+//              parseErrors) are counted by the serial task, so they are atomic.
+//              Counters already kept by the queues (RxQueue, SendQueue, Uplink) are read
+//              from them when reporting.
+//
+//            █ The Interface reads a snapshot with the STAT command, or asks for one
+//              every <ms> milliseconds (0 = stop):
+//
+//                C|--|--|STAT       --> S|--|--|STAT=...
+//                C|--|--|STAT|ms    --> S|--|--|STAT=... (now and then every ms)
+//
+//              STAT= fields (comma separated, all counts are since boot):
+//
+//                 1 uptime        : seconds since boot
+//                 2 loops         : radio task passes per second
+//                 3 rxData        : W (Widget Data) frames received from Nodes
+//                 4 rxSystem      : S (System Data) frames received from Nodes
+//                 5 rxCommands    : C frames received from Nodes (including 'c' copies)
+//                 6 rxBytes       : bytes received from Nodes
+//                 7 txRecords     : Data Strings relayed to the Interface
+//                 8 txBytes       : bytes written to the serial port
+//                 9 cmdIn         : Command Strings from the Interface
+//                10 cmdBytes      : bytes read from the serial port
+//                11 txFrames      : ESP-NOW send attempts to Nodes (including retries)
+//                12 txFrameBytes  : bytes sent to Nodes
+//                13 dropRxQueue   : frames dropped, receive queue full
+//                14 dropInvalid   : frames dropped, too short, bad nodeID or unknown type
+//                15 dropNoNode    : commands dropped, target Node not registered
+//                16 dropSend      : messages dropped by the send queue (full or retries used up)
+//                17 stalls        : serial TX flushes that could not write everything
+//                18 parseErrors   : invalid or too long Command Strings from the Interface
+//                19 maxLatency    : worst receive-to-serial-write time of a Data String (microseconds)
+//                20 unconfirmed   : messages for a Node broadcast without delivery status (no free ESP-NOW peer)
+//                21 relayedW      : W (Widget Data) Data Strings relayed to the Interface
+//                22 relayedS      : S (System Data) Data Strings relayed to the Interface
+//                23 relayedC      : C Command Strings relayed to Nodes (from the Interface or other Nodes)
+//                24 relayedE      : E emergency stops relayed to Nodes
+//
+//              txRecords (7) is the sum of relayedW and relayedS.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef STATS_H
+#define STATS_H
+
+//--- Includes --------------------------------------------
+
+#include <atomic>
+#include <Arduino.h>
+
+//--- Defines ---------------------------------------------
+
+#define STAT_LOOP_WINDOW   1000000L  // Microseconds per loops-per-second measurement
+#define MIN_STAT_PERIOD         100  // Shortest period of automatic STAT reports (milliseconds)
+
+
+//=========================================================
+//  class Stats
+//=========================================================
+
+class Stats
+{
+  protected:
+    uint32_t  windowLoops    = 0;  // Loops in the current window
+    int64_t   windowStart    = 0;
+    uint32_t  loopsPerSecond = 0;  // Loop rate of the last full window
+
+  public:
+    //--- From Nodes ---
+    uint32_t  rxData       = 0;
+    uint32_t  rxSystem     = 0;
+    uint32_t  rxCommands   = 0;
+    uint32_t  rxBytes      = 0;
+
+    //--- To the Interface ---
+    uint32_t  txRecords     = 0;
+    uint32_t  relayedData   = 0;
+    uint32_t  relayedSystem = 0;
+
+    //--- To Nodes ---
+    uint32_t  txUnconfirmed   = 0;
+    uint32_t  relayedCommands = 0;
+    uint32_t  relayedEStops   = 0;
+
+    //--- From the Interface (serial task) ---
+    std::atomic<uint32_t>  cmdIn       {0};
+    std::atomic<uint32_t>  cmdBytes    {0};
+    std::atomic<uint32_t>  parseErrors {0};
+
+    //--- Drops ---
+    uint32_t  dropInvalid  = 0;
+    uint32_t  dropNoNode   = 0;
+
+    void      CountLoop         (int64_t now);  // Call once per radio task pass
+    void      CountRecord       (char type);    // Call for each Data String relayed to the Interface
+    uint32_t  GetLoopsPerSecond ();
+};
+
+#endif
@@ -0,0 +1,229 @@
+//=========================================================
+//
+//     FILE : TwinTable.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : TwinTable class:
+//            Keeps a shadow copy (twin) of every Node and Device the Relayer has heard from.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "TwinTable.h"
+
+//--- Declarations ----------------------------------------
+
+int ParseID (const char *id);
+
+void CopyTwinField (char *field, int size, const char *start, const char *end);
+
+//--- Constructor -----------------------------------------
+
+TwinTable::TwinTable ()
+{
+  memset (nodes, 0, sizeof(nodes));
+}
+
+//--- Update ----------------------------------------------
+
+void TwinTable::Update (int nodeIndex, const char *dataString, int length, int64_t timestamp, int airtime)
+{
+  if (nodeIndex < 0 || nodeIndex >= MAX_NODES)
+    return;
+
+  // Allocate the Node twin the first time it is heard from
+  if (nodes[nodeIndex] == NULL)
+  {
+    nodes[nodeIndex] = (NodeTwin *) calloc (1, sizeof(NodeTwin));
+    if (nodes[nodeIndex] == NULL)
+      return;
+  }
+
+  length = strnlen (dataString, length);
+  if (length < VC_OFFSET)
+    return;
+
+  NodeTwin    *node        = nodes[nodeIndex];
+  int          deviceIndex = ParseID (dataString + 5);
+  const char  *values      = dataString + VC_OFFSET;
+
+  //--- Widget Data ---
+  if (dataString[0] == 'W')
+  {
+    DeviceTwin *device = getDevice (nodeIndex, deviceIndex);
+    if (device == NULL)
+      return;
+
+    // Frame size and airtime, averaged over about 8 frames
+    device->avgLength = (device->avgLength == 0) ? length : (uint16_t)((7*device->avgLength + length) / 8);
+    if (airtime > 0)
+      device->avgAirtime = (device->avgAirtime == 0) ? airtime : (uint16_t)((7*device->avgAirtime + airtime) / 8);
+
+    int valueLength = length - VC_OFFSET;
+    if (valueLength > MAX_ESPNOW_LENGTH)
+      valueLength = 0;  // Too long to keep
+
+    memcpy (device->value, values, valueLength);
+    device->value[valueLength] = 0;
+    device->valueLength = valueLength;
+    device->valueTime   = timestamp;
+    return;
+  }
+
+  //--- System Data about the Node ---
+  if (deviceIndex < 0)
+  {
+    // NOINFO=name,version,macAddress,numDevices
+    if (strncmp (values, "NOINFO=", 7) == 0)
+    {
+      const char *field[4] = { values + 7 };
+      for (int i=1; i<4; i++)
+      {
+        field[i] = strchr (field[i-1], ',');
+        if (field[i] == NULL) return;
+        ++field[i];
+      }
+
+      CopyTwinField (node->name,    TWIN_NAME_LENGTH,    field[0], field[1] - 1);
+      CopyTwinField (node->version, TWIN_VERSION_LENGTH, field[1], field[2] - 1);
+      CopyTwinField (node->mac,     TWIN_MAC_LENGTH,     field[2], field[3] - 1);
+      node->numDevices = atoi (field[3]);
+      node->infoTime   = timestamp;
+      node->hasInfo    = true;
+
+      if (node->numDevices < 0)                node->numDevices = 0;
+      if (node->numDevices > TWIN_MAX_DEVICES) node->numDevices = TWIN_MAX_DEVICES;
+    }
+    else if (strncmp (values, "NONAME=", 7) == 0)
+      CopyTwinField (node->name, TWIN_NAME_LENGTH, values + 7, dataString + length);
+
+    return;
+  }
+
+  //--- System Data about a Device ---
+  DeviceTwin *device = getDevice (nodeIndex, deviceIndex);
+  if (device == NULL)
+    return;
+
+  if (strncmp (values, "DEINFO=", 7) == 0)
+  {
+    // DEINFO=name,version,ipEnabled,ppEnabled,rate
+    const char *field[5] = { values + 7 };
+    for (int i=1; i<5; i++)
+    {
+      field[i] = strchr (field[i-1], ',');
+      if (field[i] == NULL) return;
+      ++field[i];
+    }
+
+    CopyTwinField (device->name,    TWIN_NAME_LENGTH,    field[0], field[1] - 1);
+    CopyTwinField (device->version, TWIN_VERSION_LENGTH, field[1], field[2] - 1);
+    device->ipEnabled = (field[2][0] == 'Y');
+    device->ppEnabled = (field[3][0] == 'Y');
+    device->rate      = strtoul (field[4], NULL, 10);
+    device->infoTime  = timestamp;
+    device->hasInfo   = true;
+  }
+  else if (strncmp (values, "DENAME=", 7) == 0)
+    CopyTwinField (device->name, TWIN_NAME_LENGTH, values + 7, dataString + length);
+  else if (strncmp (values, "RATE=", 5) == 0)
+    device->rate = strtoul (values + 5, NULL, 10);
+  else if (strcmp (values, "IP Enabled") == 0)
+    device->ipEnabled = true;
+  else if (strcmp (values, "IP Disabled") == 0)
+    device->ipEnabled = false;
+  else if (strcmp (values, "PP Enabled") == 0)
+    device->ppEnabled = true;
+  else if (strcmp (values, "PP Disabled") == 0)
+    device->ppEnabled = false;
+}
+
+//--- Invalidate ------------------------------------------
+
+void TwinTable::Invalidate (int nodeIndex)
+{
+  if (nodeIndex < 0 || nodeIndex >= MAX_NODES || nodes[nodeIndex] == NULL)
+    return;
+
+  for (int d=0; d<TWIN_MAX_DEVICES; d++)
+    free (nodes[nodeIndex]->devices[d]);
+
+  free (nodes[nodeIndex]);
+  nodes[nodeIndex] = NULL;
+}
+
+//--- IsComplete ------------------------------------------
+
+bool TwinTable::IsComplete (int nodeIndex)
+{
+  NodeTwin *node = GetNode (nodeIndex);
+  if (node == NULL || !node->hasInfo)
+    return false;
+
+  for (int d=0; d<node->numDevices; d++)
+    if (node->devices[d] == NULL || !node->devices[d]->hasInfo)
+      return false;
+
+  return true;
+}
+
+//--- GetNode ---------------------------------------------
+
+NodeTwin *TwinTable::GetNode (int nodeIndex)
+{
+  if (nodeIndex < 0 || nodeIndex >= MAX_NODES)
+    return NULL;
+
+  return nodes[nodeIndex];
+}
+
+//--- GetDevice -------------------------------------------
+
+DeviceTwin *TwinTable::GetDevice (int nodeIndex, int deviceIndex)
+{
+  NodeTwin *node = GetNode (nodeIndex);
+  if (node == NULL || deviceIndex < 0 || deviceIndex >= TWIN_MAX_DEVICES)
+    return NULL;
+
+  return node->devices[deviceIndex];
+}
+
+//--- getDevice -------------------------------------------
+
+DeviceTwin *TwinTable::getDevice (int nodeIndex, int deviceIndex)
+{
+  NodeTwin *node = GetNode (nodeIndex);
+  if (node == NULL || deviceIndex < 0 || deviceIndex >= TWIN_MAX_DEVICES)
+    return NULL;
+
+  // Allocate the Device twin the first time it is heard from
+  if (node->devices[deviceIndex] == NULL)
+    node->devices[deviceIndex] = (DeviceTwin *) calloc (1, sizeof(DeviceTwin));
+
+  return node->devices[deviceIndex];
+}
+
+
+//=========================================================
+// External "C" Functions
+//=========================================================
+
+//--- CopyTwinField ---------------------------------------
+
+void CopyTwinField (char *field, int size, const char *start, const char *end)
+{
+  // Copy start..end (not including end), cut to size chars
+  int length = (int)(end - start);
+  if (length > size) length = size;
+  if (length < 0)    length = 0;
+
+  memcpy (field, start, length);
+  field[length] = 0;
+}
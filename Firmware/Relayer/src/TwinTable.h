@@ -0,0 +1,104 @@
+//=========================================================
+//
+//     FILE : TwinTable.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : TwinTable class:
+//            Keeps a shadow copy (twin) of every Node and Device the Relayer has heard from,
+//            so the Interface can get them without asking over the air.
+//
+//            █ Twins are filled from the Data Strings passing through the Relayer:
+//
+//                NOINFO=name,version,macAddress,numDevices   NONAME=name
+//                DEINFO=name,version,ipEnabled,ppEnabled,rate
+//                DENAME=name   RATE=rate   IP Enabled/Disabled   PP Enabled/Disabled
+//
+//              and the latest Widget Data of each Device, with its capture time, size and airtime.
+//
+//            █ A Node twin is allocated when its Node is first heard from, and a Device twin when
+//              its Device is.  A Node that (re)starts with a PING loses its twins.
+//
+//            █ SYSI is answered from the twins of the Nodes that have all their info,
+//              the other Nodes are asked over the air as before:
+//
+//                C|--|--|SYSI        --> NOINFO and DEINFO of every Node, then S|--|--|SYSI=DONE,...
+//                C|--|--|SYSI|FRESH  --> ask every Node over the air
+//
+//            █ The latest Widget Data of a Device is returned with its original capture time:
+//
+//                C|nn|dd|GLVA  -->  W|nn|dd|values|timestamp   (S|nn|dd|LAST=NONE if there isn't one yet)
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef TWINTABLE_H
+#define TWINTABLE_H
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define TWIN_MAX_DEVICES     100  // deviceIDs 00-99
+#define TWIN_NAME_LENGTH      32  // Same as MAX_NAME_LENGTH of the Nodes
+#define TWIN_VERSION_LENGTH   10  // Same as MAX_VERSION_LENGTH of the Nodes
+#define TWIN_MAC_LENGTH       17  // xx:xx:xx:xx:xx:xx
+
+//--- Types -----------------------------------------------
+
+struct DeviceTwin
+{
+  bool           hasInfo;                           // DEINFO received
+  char           name[TWIN_NAME_LENGTH+1];
+  char           version[TWIN_VERSION_LENGTH+1];
+  bool           ipEnabled;
+  bool           ppEnabled;
+  unsigned long  rate;                              // Periodic process rate (calls per hour)
+  int64_t        infoTime;                          // Capture time of the DEINFO
+  uint16_t       avgLength;                         // Running averages of its Widget Data frames (bytes and
+  uint16_t       avgAirtime;                        // microseconds), 0 = none seen yet (see LinkBudget.h)
+  int            valueLength;                       // 0 = no Widget Data yet
+  int64_t        valueTime;                         // Capture time of the latest Widget Data
+  char           value[MAX_ESPNOW_LENGTH+1];        // Its values (longer ones are not kept)
+};
+
+struct NodeTwin
+{
+  bool         hasInfo;                             // NOINFO received
+  char         name[TWIN_NAME_LENGTH+1];
+  char         version[TWIN_VERSION_LENGTH+1];
+  char         mac[TWIN_MAC_LENGTH+1];
+  int          numDevices;
+  int64_t      infoTime;                            // Capture time of the NOINFO
+  DeviceTwin  *devices[TWIN_MAX_DEVICES];           // NULL until the Device is heard from
+};
+
+
+//=========================================================
+//  class TwinTable
+//=========================================================
+
+class TwinTable
+{
+  protected:
+    NodeTwin  *nodes[MAX_NODES];  // NULL until the Node is heard from
+
+    DeviceTwin  *getDevice (int nodeIndex, int deviceIndex);  // Allocates if needed
+
+  public:
+    TwinTable ();
+
+    void        Update      (int nodeIndex, const char *dataString, int length, int64_t timestamp, int airtime=0);  // d|nn|dd|values
+    void        Invalidate  (int nodeIndex);  // Node restarted
+    bool        IsComplete  (int nodeIndex);  // NOINFO and every DEINFO are known
+    NodeTwin   *GetNode     (int nodeIndex);
+    DeviceTwin *GetDevice   (int nodeIndex, int deviceIndex);
+};
+
+#endif
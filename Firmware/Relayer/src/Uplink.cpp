@@ -0,0 +1,359 @@
+//=========================================================
+//
+//     FILE : Uplink.cpp
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Uplink class:
+//            Sends all Relayer output to the SMAC Interface over the serial port.
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "Uplink.h"
+
+//--- SetMode ---------------------------------------------
+
+void Uplink::SetMode (UplinkMode newMode)
+{
+  mode = newMode;
+
+  // Start each binary session with a delimiter so the
+  // Interface can sync to the first frame
+  if (mode == UPLINK_BINARY)
+  {
+    reserve (1);
+    txBuffer[txLength++] = 0;
+  }
+}
+
+//--- GetMode ---------------------------------------------
+
+UplinkMode Uplink::GetMode ()
+{
+  return mode;
+}
+
+//--- SetEpoch --------------------------------------------
+
+void Uplink::SetEpoch (int64_t epochMicros)
+{
+  epochOffset = epochMicros - esp_timer_get_time ();
+}
+
+//--- GetTime ---------------------------------------------
+
+int64_t Uplink::GetTime (int64_t timestamp)
+{
+  return timestamp + epochOffset;
+}
+
+//--- SendString ------------------------------------------
+
+void Uplink::SendString (const char *smacString, int length, int64_t timestamp)
+{
+  // Don't count any NULL terminator sent by the Node
+  length = strnlen (smacString, length);
+
+  // The oldest waiting Data String sets the latency of the next complete flush
+  if (txOldestTime == 0)
+    txOldestTime = timestamp;
+
+  if (mode == UPLINK_BINARY)
+    sendBinary (smacString, length, timestamp);
+  else
+  {
+    // d|nn|dd|values|timestamp  (timestamp in microseconds)
+    // Built directly in the TX buffer
+    reserve (length + MAX_TIMESTAMP_LENGTH + 2);
+
+    memcpy (txBuffer + txLength, smacString, length);
+    txLength += length;
+    txBuffer[txLength++] = '|';
+    appendTime (GetTime (timestamp));
+    txBuffer[txLength++] = '\r';
+    txBuffer[txLength++] = '\n';
+  }
+
+  if (txLength > maxBacklog) maxBacklog = txLength;
+  if (txLength >= UPLINK_FLUSH_THRESHOLD) Flush ();
+}
+
+//--- SendLine --------------------------------------------
+
+void Uplink::SendLine (const char *smacString)
+{
+  int length = strlen (smacString);
+
+  if (mode == UPLINK_BINARY)
+    sendBinary (smacString, length, esp_timer_get_time ());
+  else
+  {
+    reserve (length + 2);
+    append  (smacString, length);
+    append  ("\r\n", 2);
+  }
+
+  if (txLength > maxBacklog) maxBacklog = txLength;
+  if (txLength >= UPLINK_FLUSH_THRESHOLD) Flush ();
+}
+
+//--- Service ---------------------------------------------
+
+void Uplink::Service ()
+{
+  // Flush if the buffer is full enough or its oldest byte is too old
+  if (txLength > 0)
+    if (txLength >= UPLINK_FLUSH_THRESHOLD || esp_timer_get_time () - txFirstTime >= UPLINK_FLUSH_DEADLINE)
+      Flush ();
+}
+
+//--- Flush -----------------------------------------------
+
+void Uplink::Flush (bool wait)
+{
+  if (txLength == 0)
+    return;
+
+  ++numFlushes;
+
+  // Write as much as the serial driver can take
+  int numWritten = txLength;
+  if (!wait)
+  {
+    int room = Serial.availableForWrite ();
+    if (room < numWritten)
+    {
+      numWritten = (room > 0) ? room : 0;
+      ++numStalls;
+    }
+  }
+
+  if (numWritten > 0)
+  {
+    Serial.write (txBuffer, numWritten);
+    numBytes += numWritten;
+  }
+
+  // Keep the rest (and its age) for the next flush
+  txLength -= numWritten;
+  if (txLength > 0)
+    memmove (txBuffer, txBuffer + numWritten, txLength);
+  else if (txOldestTime != 0)
+  {
+    // Everything is handed to the serial driver
+    int64_t latency = esp_timer_get_time () - txOldestTime;
+    if (latency > maxLatency) maxLatency = latency;
+    txOldestTime = 0;
+  }
+}
+
+//--- GetBacklog ------------------------------------------
+
+int Uplink::GetBacklog ()
+{
+  return txLength;
+}
+
+//--- GetMaxBacklog ---------------------------------------
+
+int Uplink::GetMaxBacklog ()
+{
+  return maxBacklog;
+}
+
+//--- GetStalls -------------------------------------------
+
+uint32_t Uplink::GetStalls ()
+{
+  return numStalls;
+}
+
+//--- GetFlushes ------------------------------------------
+
+uint32_t Uplink::GetFlushes ()
+{
+  return numFlushes;
+}
+
+//--- GetBytes --------------------------------------------
+
+uint32_t Uplink::GetBytes ()
+{
+  return numBytes;
+}
+
+//--- GetMaxLatency ---------------------------------------
+
+int64_t Uplink::GetMaxLatency ()
+{
+  return maxLatency;
+}
+
+//--- reserve ---------------------------------------------
+
+void Uplink::reserve (int numBytes)
+{
+  // Make room in the TX buffer for the next record
+  if (txLength + numBytes > UPLINK_TX_BUFFER_SIZE)
+  {
+    Flush ();
+
+    // Still no room, so wait for the serial port (this is a stall)
+    if (txLength + numBytes > UPLINK_TX_BUFFER_SIZE)
+      Flush (true);
+  }
+
+  // Start the deadline with the first waiting byte
+  if (txLength == 0)
+    txFirstTime = esp_timer_get_time ();
+}
+
+//--- append ----------------------------------------------
+
+void Uplink::append (const void *data, int numBytes)
+{
+  memcpy (txBuffer + txLength, data, numBytes);
+  txLength += numBytes;
+}
+
+//--- appendTime ------------------------------------------
+
+void Uplink::appendTime (int64_t timestamp)
+{
+  // Decimal digits of a 64-bit timestamp (ltoa is only 32 bits)
+  char      digits[20];
+  int       numDigits = 0;
+  uint64_t  value = (timestamp < 0) ? (uint64_t)(-timestamp) : (uint64_t) timestamp;
+
+  if (timestamp < 0)
+    txBuffer[txLength++] = '-';
+
+  do
+  {
+    digits[numDigits++] = '0' + (char)(value % 10);
+    value /= 10;
+  }
+  while (value > 0);
+
+  while (numDigits > 0)
+    txBuffer[txLength++] = digits[--numDigits];
+}
+
+//--- sendBinary ------------------------------------------
+
+void Uplink::sendBinary (const char *smacString, int length, int64_t timestamp)
+{
+  // The record is CRC'd and COBS encoded straight into the TX buffer
+  uint64_t  stamp = (uint64_t) GetTime (timestamp);
+  int       payloadLength = 0;
+
+  // A line without the d|nn|dd| fields (like the MAC=... reply to GMAC)
+  // is sent as System Data from the Relayer: S|--|--|line
+  bool  hasHeader = (length >= VC_OFFSET && smacString[1] == '|' && smacString[4] == '|' && smacString[7] == '|');
+  int   payloadOffset = hasHeader ? VC_OFFSET : 0;
+
+  if (length > payloadOffset)
+  {
+    payloadLength = length - payloadOffset;
+    if (payloadLength > MAX_UPLINK_PAYLOAD)
+      payloadLength = MAX_UPLINK_PAYLOAD;
+  }
+
+  reserve (UPLINK_FRAME_SIZE (UPLINK_HEADER_SIZE + payloadLength + UPLINK_CRC_SIZE));
+  cobsBegin ();
+
+  // Header from the d|nn|dd| fields of the string
+  recordPut (hasHeader ? (uint8_t) smacString[0] : 'S');
+  recordPut (hasHeader ? parseID (smacString + 2) : UPLINK_NO_ID);
+  recordPut (hasHeader ? parseID (smacString + 5) : UPLINK_NO_ID);
+  recordPut ((uint8_t)(sequence));
+  recordPut ((uint8_t)(sequence >> 8));
+  for (int i=0; i<8; i++)
+    recordPut ((uint8_t)(stamp >> (8*i)));
+  ++sequence;
+
+  // Payload is everything after the header fields
+  for (int i=0; i<payloadLength; i++)
+    recordPut ((uint8_t) smacString[payloadOffset + i]);
+
+  // CRC is not part of its own calculation
+  uint16_t recordCRC = crc;
+  cobsPut ((uint8_t)(recordCRC));
+  cobsPut ((uint8_t)(recordCRC >> 8));
+
+  cobsEnd ();
+}
+
+//--- cobsBegin -------------------------------------------
+
+void Uplink::cobsBegin ()
+{
+  // Consistent Overhead Byte Stuffing:
+  // Replaces every 0x00 with the distance to the next 0x00
+  // so 0x00 can be used as the frame delimiter.
+  cobsCodeIndex = txLength++;
+  cobsCode      = 1;
+  crc           = 0xFFFF;
+}
+
+//--- cobsPut ---------------------------------------------
+
+void Uplink::cobsPut (uint8_t value)
+{
+  if (value == 0)
+  {
+    txBuffer[cobsCodeIndex] = cobsCode;
+    cobsCode = 1;
+    cobsCodeIndex = txLength++;
+  }
+  else
+  {
+    txBuffer[txLength++] = value;
+
+    if (++cobsCode == 0xFF)
+    {
+      txBuffer[cobsCodeIndex] = cobsCode;
+      cobsCode = 1;
+      cobsCodeIndex = txLength++;
+    }
+  }
+}
+
+//--- cobsEnd ---------------------------------------------
+
+void Uplink::cobsEnd ()
+{
+  txBuffer[cobsCodeIndex] = cobsCode;
+  txBuffer[txLength++] = 0;  // Frame delimiter
+}
+
+//--- recordPut -------------------------------------------
+
+void Uplink::recordPut (uint8_t value)
+{
+  // CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+  crc ^= (uint16_t) value << 8;
+  for (int bit=0; bit<8; bit++)
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+
+  cobsPut (value);
+}
+
+//--- parseID ---------------------------------------------
+
+uint8_t Uplink::parseID (const char *id)
+{
+  // Two ASCII digits (00-99), anything else is "--"
+  if (id[0] < '0' || id[0] > '9' || id[1] < '0' || id[1] > '9')
+    return UPLINK_NO_ID;
+
+  return (uint8_t)(10*(id[0]-'0') + (id[1]-'0'));
+}
@@ -0,0 +1,147 @@
+//=========================================================
+//
+//     FILE : Uplink.h
+//
+//  PROJECT : SMAC Framework
+//
+//    NOTES : Uplink class:
+//            Sends all Relayer output to the SMAC Interface over the serial port.
+//
+//            █ TEXT mode (the default) sends each SMAC string as a line of text:
+//
+//                d|nn|dd|values|timestamp
+//
+//              The timestamp is the 64-bit capture time in microseconds.  It counts from
+//              boot, or from the Unix epoch once the Interface has set the clock with STIM:
+//
+//                C|--|--|STIM|epochMilliseconds  --> S|--|--|TIME=epochMicroseconds
+//
+//            █ BINARY mode sends each SMAC string as a COBS framed record.
+//              Each frame is terminated with a 0x00 byte.  A decoded record is:
+//
+//                ┌──────┬──────┬────────┬──────────┬─────────────┬─────────┬────────┐
+//                │ type │ node │ device │ sequence │  timestamp  │ payload │  CRC   │
+//                │  1   │  1   │   1    │  2 (LE)  │   8 (LE)    │ 0-2200  │ 2 (LE) │
+//                └──────┴──────┴────────┴──────────┴─────────────┴─────────┴────────┘
+//
+//                type      : 'W', 'S' or 'C' (same as the first char of the text string)
+//                node      : 0-99, or 0xFF for "--"
+//                device    : 0-99, or 0xFF for "--"
+//                sequence  : incremented for every record, used to detect lost records
+//                timestamp : signed capture time in microseconds (same clock as TEXT mode)
+//                payload   : the values/command field as raw bytes (no terminator)
+//                            up to 250 bytes, or MAX_FRAGMENTS*FRAGMENT_CHUNK for a reassembled Data String
+//                CRC       : CRC-16/CCITT-FALSE of all the bytes before it
+//
+//              A line without the d|nn|dd| fields (the MAC=... reply to GMAC) is sent as an 'S'
+//              record from node and device 0xFF, with the whole line as its payload.
+//
+//            █ The Interface switches modes with the SUPM command:
+//
+//                C|--|--|SUPM|BIN   --> S|--|--|UPLINK=BIN,2  (version 2 record format)
+//                C|--|--|SUPM|TEXT  --> S|--|--|UPLINK=TEXT
+//
+//              The acknowledgement is sent in the old mode, then the new mode starts.
+//
+//            █ Records are appended directly into a TX staging buffer (no intermediate copy).
+//              The buffer is written to the serial port with one large write when it reaches
+//              UPLINK_FLUSH_THRESHOLD bytes, or when its oldest byte is UPLINK_FLUSH_DEADLINE
+//              microseconds old.  Service() must be called often to meet the deadline.
+//
+//              A flush only writes what the serial driver can take without blocking.
+//              Each flush that cannot write everything counts as a stall.
+//
+//                C|--|--|GTXQ  --> S|--|--|TXQ=backlog,maxBacklog,stalls,flushes
+//
+//   AUTHOR : Bill Daniels
+//            Copyright 2021-2026, D+S Tech Labs, Inc.
+//            All Rights Reserved
+//
+//=========================================================
+
+#ifndef UPLINK_H
+#define UPLINK_H
+
+//--- Includes --------------------------------------------
+
+#include <Arduino.h>
+#include "Relayer.h"
+
+//--- Defines ---------------------------------------------
+
+#define UPLINK_VERSION             2  // Binary record format version
+#define UPLINK_HEADER_SIZE        13  // type, node, device, sequence(2), timestamp(8)
+#define UPLINK_CRC_SIZE            2
+#define UPLINK_NO_ID            0xFF  // Binary node/device ID for "--"
+#define MAX_UPLINK_PAYLOAD    (MAX_LONG_LENGTH - VC_OFFSET)
+#define UPLINK_FRAME_SIZE(r)  ((r) + (r)/254 + 2)  // Record size plus COBS overhead and 0x00 delimiter
+
+#define UPLINK_TX_BUFFER_SIZE   4096  // Bytes of TX staging buffer
+#define UPLINK_FLUSH_THRESHOLD  1024  // Flush when this many bytes are waiting ...
+#define UPLINK_FLUSH_DEADLINE   2000  // ... or when the oldest waiting byte is this many microseconds old
+
+//--- Types -----------------------------------------------
+
+enum UplinkMode
+{
+  UPLINK_TEXT,
+  UPLINK_BINARY
+};
+
+
+//=========================================================
+//  class Uplink
+//=========================================================
+
+class Uplink
+{
+  protected:
+    UplinkMode  mode        = UPLINK_TEXT;
+    uint16_t    sequence    = 0;
+    int64_t     epochOffset = 0;  // Added to boot-time timestamps once the Interface sets the clock
+
+    //--- TX staging buffer ---
+    uint8_t     txBuffer[UPLINK_TX_BUFFER_SIZE];
+    int         txLength     = 0;   // Bytes waiting to be written
+    int64_t     txFirstTime  = 0;   // Time the oldest waiting byte was added
+    int         maxBacklog   = 0;   // Largest number of bytes ever waiting
+    uint32_t    numStalls    = 0;   // Flushes that could not write everything
+    uint32_t    numFlushes   = 0;
+    uint32_t    numBytes     = 0;   // Bytes written to the serial port
+    int64_t     txOldestTime = 0;   // Capture time of the oldest waiting Data String, 0 = none
+    int64_t     maxLatency   = 0;   // Worst capture-to-serial-write time (microseconds)
+
+    //--- COBS encoder state ---
+    int         cobsCodeIndex;
+    uint8_t     cobsCode;
+    uint16_t    crc;
+
+    void     reserve    (int numBytes);
+    void     append     (const void *data, int numBytes);
+    void     appendTime (int64_t timestamp);
+    void     sendBinary (const char *smacString, int length, int64_t timestamp);
+    void     cobsBegin  ();
+    void     cobsPut    (uint8_t value);
+    void     cobsEnd    ();
+    void     recordPut  (uint8_t value);  // Add one record byte to the CRC and COBS encode it
+    uint8_t  parseID    (const char *id);
+
+  public:
+    void        SetMode    (UplinkMode newMode);
+    UplinkMode  GetMode    ();
+    void        SetEpoch   (int64_t epochMicros);  // Set the current time as microseconds since the Unix epoch
+    int64_t     GetTime    (int64_t timestamp);    // Convert a boot-time timestamp to uplink time
+    void        SendString (const char *smacString, int length, int64_t timestamp);  // Relay a Data String with its timestamp
+    void        SendLine   (const char *smacString);                                  // Send a Relayer message (no timestamp)
+    void        Service    ();                                                        // Flush on threshold or deadline; call from the serial task
+    void        Flush      (bool wait=false);                                         // Write waiting bytes; wait=true blocks until all are written
+
+    int         GetBacklog    ();
+    int         GetMaxBacklog ();
+    uint32_t    GetStalls     ();
+    uint32_t    GetFlushes    ();
+    uint32_t    GetBytes      ();
+    int64_t     GetMaxLatency ();
+};
+
+#endif
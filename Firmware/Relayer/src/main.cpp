@@ -31,6 +31,10 @@
 //              to the SMAC Interface for Diagnostic display only.  This allows a Node
 //              or Device to send a Command to another Node/Device.
 //
+//            ∙ The Relayer runs as two FreeRTOS tasks, one per core.  The radio task
+//              handles ESP-NOW and the Nodes, the serial task reads Command Strings
+//              from and writes everything to the Interface (see Relayer::Start).
+//
 //            ∙ Each Node in your SMAC system will need to know the Relayer's MAC Address.
 //              Use the Set MAC Tool (setMAC.html in the Interface folder) to set the
 //              Relayer's MAC address for each Node.
@@ -87,7 +91,7 @@ void setup()
 
   // Instantiate the Relayer
   TheRelayer = new Relayer ();
-  if (TheRelayer->IsOkay ())
+  if (TheRelayer->IsOkay () && TheRelayer->Start ())
   {
     // All good, go green
     STATUS_LED_GOOD;
@@ -101,5 +105,6 @@ void setup()
 
 void loop()
 {
-  TheRelayer->Run ();
+  // The Relayer runs in its own radio and serial tasks
+  vTaskDelete (NULL);
 }
@@ -25,7 +25,7 @@ const SerialPortSettings =
   dataBits    : 8,
   stopBits    : 1,
   parity      : 'none',
-  bufferSize  : 1024,
+  bufferSize  : 16384,  // Large enough for native USB and high baud rates
   flowControl : 'none'
 };
 
@@ -34,9 +34,17 @@ let PagesLoaded          = false;
 let StatusMessageTimeout = undefined;
 let SMACPort             = undefined;  // SerialPort object (to be created if supported)
 let DateTimeInterval     = undefined;  // Used to update the Status Bar Date/Time
+let CommandBatch         = [];         // Command Strings waiting for the serial port
+let CommandSending       = false;      // A write to the serial port is in progress
+let Reopening            = false;      // The serial port is being re-opened at a new baud rate (SBAU)
+let CommandsCoalesced    = 0;          // Latest-wins commands replaced before they were written
+let LastRelayerMessage   = 0;          // Date.now() of the last line from the Relayer
+
+const MaxBatchLength = 2000;  // Longest batch line (the Relayer accepts up to 2047 chars)
+const BaudConfirmTime = 2000;  // Millis to wait for the Relayer's reply after switching baud rates (SBAU)
 
 //--- Node Array: ---
-const MaxNodes = 20;  // Limited to 20 due to ESP-NOW peer limit
+const MaxNodes = 100;  // nodeIDs 00-99 (the Relayer swaps ESP-NOW peers as needed)
 let   Nodes = [MaxNodes];  // Holds Node objects:
                            // {                                        ┌─
                            //   name,                                  │  {
@@ -45,8 +53,9 @@ let   Nodes = [MaxNodes];  // Holds Node objects:
                            //   numDevices,                            │    ipEnabled,
                            //   devices[],  - array of Device objects ─┤    ppEnabled,
                            //   monitor,                               │    rate
-                           //   lastMsgTime                            │  }
-                           // }                                        └─
+                           //   lastMsgTime,                           │  }
+                           //   down        - NODEDOWN/NODEUP          └─
+                           // }
                            // The index is the nodeID
 
 //--- Status Bar (object) ---------------------------------
@@ -279,6 +288,9 @@ async function ConnectToRelayer ()
         // Wait for Relayer
         setTimeout (async () =>
         {
+          // Set the Relayer's clock so timestamps are in Unix epoch time
+          await Send_UItoRelayer (0, 0, 'STIM', Date.now ().toString ());
+
           // Request full system info from the Relayer
           await Send_UItoRelayer (0, 0, 'SYSI');  // System Info command
 
@@ -370,12 +382,18 @@ async function ProcessRelayerMessage (smacString)
     // SMAC Commands start with a 'C' and are just logged to the monitor.
     //
     //   ┌─────── 1-char packet type ('W', 'S' or 'C')
-    //   │ ┌───── 2-char nodeID (00-19)
+    //   │ ┌───── 2-char nodeID (00-99)
     //   │ │  ┌── 2-char deviceID (00-99)
     //   │ │  │
     //   d|nn|dd|...
     //=======================================================================
 
+    LastRelayerMessage = Date.now ();
+
+    // The Relayer's MAC address (GMAC) only confirms the link after a baud rate change
+    if (smacString.startsWith ('MAC='))
+      return;
+
     // Check for minimum number of fields
     const fields = smacString.split ('|');
     if (fields.length < MinMessageFields)
@@ -384,6 +402,13 @@ async function ProcessRelayerMessage (smacString)
       return;
     }
 
+    // The Relayer is switching its UART to a new baud rate (SBAU); follow it
+    if (smacString.startsWith ('S|--|--|BAUD='))
+    {
+      await ChangeBaudRate (fields[3].substring (5));
+      return;
+    }
+
     const nodeIndex   = Number (fields[1]);  // nodeID   is "--" if this is a Relayer message
     const deviceIndex = Number (fields[2]);  // deviceID is "--" if this is a Node message
 
@@ -405,7 +430,7 @@ async function ProcessRelayerMessage (smacString)
     if (smacString[0] == 'W' || smacString[0] == 'S')
     {
       const values    = fields[3];           // values should NOT have the '|' char in it !!!
-      const timestamp = Number (fields[4]);
+      const timestamp = Number (fields[4]) / 1000;  // Relayer sends microseconds, keep milliseconds with a fraction
 
       //=======================================================================
       // Handle Widget Data first (for fast Widget updates)
@@ -421,6 +446,8 @@ async function ProcessRelayerMessage (smacString)
       // Handle System Data values:
       //=====================================================================
       //   NEWNODE
+      //   NODEDOWN=
+      //   NODEUP=
       //   NOINFO=
       //   DEINFO=
       //   NONAME=
@@ -453,6 +480,27 @@ async function ProcessRelayerMessage (smacString)
         await Send_UItoRelayer (nodeIndex, 0, 'GDEI');
       }
 
+      else if (values.startsWith ('NODEDOWN='))
+      {
+        // The Relayer has not heard from this Node for its liveness time (see SLIV)
+        if (Nodes[nodeIndex] != undefined)
+          Nodes[nodeIndex].down = true;
+
+        const msg = 'Node ' + nodeIndex.toString() + ' not responding';
+        StatusBar.SetMessage (msg, '#F00000');
+        Diagnostics.LogToMonitor (nodeIndex, msg);
+      }
+
+      else if (values.startsWith ('NODEUP='))
+      {
+        if (Nodes[nodeIndex] != undefined)
+          Nodes[nodeIndex].down = false;
+
+        const msg = 'Node ' + nodeIndex.toString() + ' responding again after ' + values.substring(7) + ' ms';
+        StatusBar.SetMessage (msg, '#F0F000');
+        Diagnostics.LogToMonitor (nodeIndex, msg);
+      }
+
       else if (values.startsWith ('NOINFO='))
       {
         // Add new Node if it does NOT exist already
@@ -468,7 +516,8 @@ async function ProcessRelayerMessage (smacString)
                                 numDevices  : Number (niFields[3]),
                                 devices     : [],          // Device objects { name, version, ipEnabled, ppEnabled, rate }
                                 monitor     : undefined,
-                                lastMsgTime : timestamp
+                                lastMsgTime : timestamp,
+                                down        : false        // Set by the Relayer's NODEDOWN/NODEUP
                               };
 
           // Update the Diagnostics UI
@@ -614,20 +663,69 @@ async function ProcessRelayerMessage (smacString)
   }
 }
 
+//--- ChangeBaudRate --------------------------------------
+
+async function ChangeBaudRate (rate)
+{
+  try
+  {
+    // S|--|--|BAUD=rate is the Relayer's last line at the old rate.
+    // Re-open the port at the new rate, then check that the Relayer answers (GMAC).
+    // Native USB (BAUD=USB) runs at full speed whatever the rate, so nothing changes.
+    const newRate = Number (rate);
+    if (isNaN (newRate))
+      return;
+
+    // Hold commands in the batch while the port is closed
+    Reopening = true;
+
+    SerialPortSettings.baudRate = newRate;
+    const reopened = await SMACPort.Reopen (SerialPortSettings);
+
+    Reopening = false;
+
+    if (!reopened)
+    {
+      CommandBatch = [];
+      PopupMessage ('SMAC Interface', 'Unable to re-open the port at ' + newRate + ' baud.');
+      return;
+    }
+
+    SMACPort.ReadLoop ();
+
+    // Round trip at the new rate; this also sends the commands held during the re-open
+    const sentTime = Date.now ();
+    await Send_UItoRelayer (0, 0, 'GMAC');
+
+    setTimeout (() =>
+    {
+      if (LastRelayerMessage > sentTime)
+        StatusBar.SetMessage ('Relayer link is now ' + newRate + ' baud', '#F0F000');
+      else
+        StatusBar.SetMessage ('No reply from the Relayer at ' + newRate + ' baud', '#F00000');
+    }, BaudConfirmTime);
+  }
+  catch (ex)
+  {
+    Reopening = false;
+    ShowException (ex);
+  }
+}
+
 //--- CheckNodes ------------------------------------------
 
 function CheckNodes ()
 {
   try
   {
-    const now = Date.now ();
-
     // Check if all Nodes are still alive
     for (let i=0; i<MaxNodes; i++)
     {
       if (Nodes[i] != undefined)
       {
-        if (now - Nodes[i].lastMsgTime > 31000)
+        // Idle Nodes only send heartbeats to the Relayer, so their message gaps
+        // say nothing; the Relayer tells when a Node goes down (NODEDOWN)
+        if (Nodes[i].down)
         {
 
 
@@ -652,17 +750,21 @@ function CheckNodes ()
 
 //--- Send_UItoRelayer ------------------------------------
 
-async function Send_UItoRelayer (nodeIndex, deviceIndex, commandString, paramString)
+async function Send_UItoRelayer (nodeIndex, deviceIndex, commandString, paramString, latestWins=false)
 {
   try
   {
     // Command Format: C|nodeID|deviceID|command|params
     // where:
     //   type     = 'C' for Command
-    //   nodeID   = 2-digits 00-19
+    //   nodeID   = 2-digits 00-99
     //   deviceID = 2-digits 00-99
     //   command  = 4-chars (usually caps)
     //   params   = optional parameters (null terminated string)
+    //
+    // Set latestWins for setpoints from sliders, dials and joysticks.  The command is sent as
+    // ~C|nodeID|deviceID|command|params and only the newest one is delivered if an older one
+    // is still waiting here or in the Relayer (see GSDQ for the Relayer's count).
 
     if (nodeIndex == undefined || deviceIndex == undefined || commandString == undefined)
       return;
@@ -674,15 +776,25 @@ async function Send_UItoRelayer (nodeIndex, deviceIndex, commandString, paramStr
 
     const fullUIMessage = "C|" + nodeID + '|' + deviceID + '|' + command + params;
 
-    try
-    {
-      await SMACPort.Send (fullUIMessage + '\n');
-    }
-    catch (ex)
+    // Commands from a busy widget pile up while the port is writing,
+    // then go out together as one batch line
+    if (latestWins)
     {
-      console.error (ex);
-      return;
+      const key     = '~' + fullUIMessage.substring (0, 12);
+      const pending = CommandBatch.findIndex ((waiting) => waiting.startsWith (key));
+
+      if (pending >= 0)
+      {
+        CommandBatch[pending] = '~' + fullUIMessage;
+        CommandsCoalesced++;
+      }
+      else
+        CommandBatch.push ('~' + fullUIMessage);
     }
+    else
+      CommandBatch.push (fullUIMessage);
+    if (!CommandSending && !Reopening)
+      await SendCommandBatch ();
 
     if (Debugging)
       console.info ('<-- ' + fullUIMessage);
@@ -698,6 +810,71 @@ async function Send_UItoRelayer (nodeIndex, deviceIndex, commandString, paramStr
 }
 
 
+//--- Send_EStop ------------------------------------------
+
+async function Send_EStop (nodeIndex, deviceIndex)
+{
+  try
+  {
+    // Emergency stop: E|nodeID|deviceID|ESTP
+    // nodeID can be '--' (all Nodes) or a group 'G0'-'G9', deviceID can be '--' (all Devices).
+    // Written straight to the port, ahead of any batched commands; the Relayer
+    // also sends it ahead of everything else and reports S|nn|dd|ESTOP=seq,latency.
+    if (nodeIndex == undefined || deviceIndex == undefined)
+      return;
+
+    const nodeID   = nodeIndex  .toString().padLeft ('0', 2);
+    const deviceID = deviceIndex.toString().padLeft ('0', 2);
+    const eStop    = 'E|' + nodeID + '|' + deviceID + '|ESTP';
+
+    await SMACPort.Send (eStop + '\n');
+
+    if (Diagnostics.DataLogging && !isNaN (Number (nodeIndex)))
+      Diagnostics.LogToMonitor (Number (nodeIndex), '◀── ' + eStop);
+  }
+  catch (ex)
+  {
+    ShowException (ex);
+  }
+}
+
+//--- SendCommandBatch ------------------------------------
+
+async function SendCommandBatch ()
+{
+  // Batch line format: B|commandString;commandString;...
+  // A Command String with a ';' in its params is always sent on its own line.
+  CommandSending = true;
+
+  try
+  {
+    while (CommandBatch.length > 0 && !Reopening)
+    {
+      let count = 1;
+      let line  = CommandBatch[0];
+
+      if (!line.includes (';'))
+      {
+        while (count < CommandBatch.length && !CommandBatch[count].includes (';') &&
+               line.length + CommandBatch[count].length + 3 <= MaxBatchLength)
+          line += ';' + CommandBatch[count++];
+
+        if (count > 1)
+          line = 'B|' + line;
+      }
+
+      CommandBatch.splice (0, count);
+      await SMACPort.Send (line + '\n');
+    }
+  }
+  catch (ex)
+  {
+    console.error (ex);
+    CommandBatch = [];
+  }
+
+  CommandSending = false;
+}
 
 // //--- BroadcastUIMessage ----------------------------------
 //
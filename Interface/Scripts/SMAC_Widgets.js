@@ -54,6 +54,9 @@
 //               alarmLow    = "..."
 //               alarmHigh   = "..."
 //
+//             The moveAction/changeAction handlers of sliders, dials and joysticks should send their setpoints with
+//             Send_UItoRelayer (node, device, command, params, true) so a busy link only delivers the newest one.
+//
 //             Handling right-click context menu popups:
 //               this.addEventListener ('contextmenu', (event) => { StopEvent(event); doYourStuff(); });
 //
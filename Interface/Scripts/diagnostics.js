@@ -231,7 +231,7 @@ const Diagnostics =
         if (Number (slider.value) < 1)
           slider.value = '1';
 
-        await Send_UItoRelayer (nodeIndex, devIndex, 'SRAT', slider.value);
+        await Send_UItoRelayer (nodeIndex, devIndex, 'SRAT', slider.value, true);
       }
     }
     catch (ex)
@@ -64,6 +64,7 @@ class SerialPort
       this.serialWriter       = undefined;
       this.process            = inputProcessFunction;
       this.portOpened         = false;
+      this.reopening          = false;  // Reopen() is closing the port; ReadLoop() must not start again
       this.disconnectFunction = disconnectFunction;
 
       this.TDS = undefined;  // TextDecoderStream     - for reading
@@ -157,6 +158,49 @@ class SerialPort
     });
   }
 
+  //--- Reopen --------------------------------------------
+
+  async Reopen (serialSettings)
+  {
+    // Closes the port and opens it again with new settings (e.g. a new baud rate).
+    // Resolves true when it is open again; then call ReadLoop() again.
+    try
+    {
+      this.reopening = true;
+      await this.CloseStreams ();
+
+      // The read stream lets go of the port shortly after it is cancelled
+      for (let i=0; ; i++)
+      {
+        try
+        {
+          await this.webPort.close ();
+          break;
+        }
+        catch (ex)
+        {
+          if (i >= 20)
+            throw ex;
+
+          await new Promise (resolve => setTimeout (resolve, 50));
+        }
+      }
+
+      await this.webPort.open (serialSettings);
+
+      this.reopening = false;
+      return true;
+    }
+    catch (ex)
+    {
+      console.info ('Reopen() failed: ' + ex);
+
+      this.reopening  = false;
+      this.portOpened = false;
+      return false;
+    }
+  }
+
   //--- IsOpen --------------------------------------------
 
   IsOpen ()
@@ -211,7 +255,7 @@ class SerialPort
             {
               // Usually 'buffer overrun'
               await this.CloseStreams ();
-              tryAgain = true;
+              tryAgain = !this.reopening;
               break;
             }
           }